@@ -0,0 +1,65 @@
+#include "Arena.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+std::atomic<quint64> HotPathAllocations::s_count{ 0 };
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize)
+{
+}
+
+Arena::~Arena()
+{
+    for (const Block &block : m_blocks)
+        std::free(block.data);
+}
+
+void *Arena::allocate(size_t bytes, size_t alignment)
+{
+    // Try the current block, then any later block kept from before a rewind
+    while (m_current < m_blocks.size()) {
+        const Block &block = m_blocks[m_current];
+        const size_t start = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= block.size) {
+            m_offset = start + bytes;
+            return block.data + start;
+        }
+        m_current++;
+        m_offset = 0;
+    }
+
+    // Out of space, grow by one block large enough for the request
+    const size_t size = std::max(m_blockSize, bytes);
+    Block block{ static_cast<char *>(std::malloc(size)), size };
+    if (!block.data)
+        throw std::bad_alloc();
+    HotPathAllocations::add();
+    m_blocks.push_back(block);
+    m_current = m_blocks.size() - 1;
+
+    // malloc returns memory aligned for any fundamental type
+    m_offset = bytes;
+    return block.data;
+}
+
+void Arena::reset()
+{
+    m_current = 0;
+    m_offset = 0;
+}
+
+size_t Arena::reservedBytes() const
+{
+    size_t total = 0;
+    for (const Block &block : m_blocks)
+        total += block.size;
+    return total;
+}
+
+Arena &Arena::threadLocal()
+{
+    thread_local Arena arena;
+    return arena;
+}
@@ -0,0 +1,76 @@
+// Arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Counts arena and pool allocations only: arena blocks and sample buffers the
+// pool had to create. Containers outside them, such as the point lists handed
+// to the chart series, are not counted. Once the arenas and the pool have
+// warmed up, regenerating the same plots leaves it unchanged.
+class HotPathAllocations
+{
+public:
+    static void add() { s_count.fetch_add(1, std::memory_order_relaxed); }
+    static quint64 count() { return s_count.load(std::memory_order_relaxed); }
+
+private:
+    static std::atomic<quint64> s_count;
+};
+
+// Bump allocator for transient scratch memory. Allocation is a pointer bump
+// inside large blocks; nothing is freed individually. Scope marks the current
+// position and rewinds to it on destruction, so repeated evaluations reuse
+// the same blocks and stop allocating after the first call.
+class Arena
+{
+public:
+    static constexpr size_t DefaultBlockSize = 256 * 1024;
+
+    explicit Arena(size_t blockSize = DefaultBlockSize);
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T *allocateArray(size_t count) { return static_cast<T *>(allocate(count * sizeof(T), alignof(T))); }
+
+    // Release everything allocated so far, keeping the blocks for reuse
+    void reset();
+
+    size_t reservedBytes() const;
+
+    // Arena owned by the calling thread, used for evaluation scratch
+    static Arena &threadLocal();
+
+    class Scope
+    {
+    public:
+        explicit Scope(Arena &arena) : m_arena(arena), m_block(arena.m_current), m_offset(arena.m_offset) {}
+        ~Scope() { m_arena.m_current = m_block; m_arena.m_offset = m_offset; }
+
+    private:
+        Arena &m_arena;
+        size_t m_block;
+        size_t m_offset;
+    };
+
+private:
+    struct Block {
+        char *data;
+        size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_current = 0;
+    size_t m_offset = 0;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "ChartImageLayer.h"
+#include <QPainter>
+
+ChartImageLayer::ChartImageLayer(QGraphicsItem *parent)
+    : QGraphicsItem(parent)
+{
+    // Above the plot area background (0), below shades, grid and series
+    setZValue(0.5);
+}
+
+void ChartImageLayer::setImage(const QImage &image, const QRectF &rect)
+{
+    prepareGeometryChange();
+    m_image = image;
+    m_rect = rect;
+    update();
+}
+
+void ChartImageLayer::clear()
+{
+    if (m_image.isNull())
+        return;
+
+    prepareGeometryChange();
+    m_image = QImage();
+    m_rect = QRectF();
+    update();
+}
+
+QRectF ChartImageLayer::boundingRect() const
+{
+    return m_rect;
+}
+
+void ChartImageLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    if (!m_image.isNull())
+        painter->drawImage(m_rect, m_image);
+}
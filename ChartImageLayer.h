@@ -0,0 +1,28 @@
+// ChartImageLayer.h
+#ifndef CHARTIMAGELAYER_H
+#define CHARTIMAGELAYER_H
+
+#include <QGraphicsItem>
+#include <QImage>
+
+// Graphics item that draws a precomputed image over the chart's plot area.
+// It is parented to the chart and stacked between the plot area background
+// and the grid, so axes, grid lines and series stay on top of it.
+class ChartImageLayer : public QGraphicsItem
+{
+public:
+    explicit ChartImageLayer(QGraphicsItem *parent = nullptr);
+
+    void setImage(const QImage &image, const QRectF &rect);
+    void clear();
+    bool hasImage() const { return !m_image.isNull(); }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+    QImage m_image;
+    QRectF m_rect;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "ColorMap.h"
+#include <QColor>
+#include <algorithm>
+
+namespace {
+
+QVector<QRgb> buildViridis()
+{
+    const QColor stops[] = {
+        QColor(68, 1, 84),
+        QColor(59, 82, 139),
+        QColor(33, 145, 140),
+        QColor(94, 201, 98),
+        QColor(253, 231, 37)
+    };
+    const int segments = int(sizeof(stops) / sizeof(stops[0])) - 1;
+
+    QVector<QRgb> lut(256);
+    for (int i = 0; i < 256; i++) {
+        const double t = i / 255.0 * segments;
+        const int s = std::min(int(t), segments - 1);
+        const double f = t - s;
+        const QColor &a = stops[s];
+        const QColor &b = stops[s + 1];
+        lut[i] = qRgb(int(a.red() + (b.red() - a.red()) * f),
+                      int(a.green() + (b.green() - a.green()) * f),
+                      int(a.blue() + (b.blue() - a.blue()) * f));
+    }
+    return lut;
+}
+
+} // namespace
+
+const QVector<QRgb> &ColorMap::viridis()
+{
+    static const QVector<QRgb> lut = buildViridis();
+    return lut;
+}
@@ -0,0 +1,16 @@
+// ColorMap.h
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include <QRgb>
+#include <QVector>
+
+// Colour ramps shared by the image-based plot layers
+class ColorMap
+{
+public:
+    // Viridis-like ramp as a 256 entry lookup table, dark purple to yellow
+    static const QVector<QRgb> &viridis();
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "CrosshairLayer.h"
+#include <QFontMetricsF>
+#include <QPainter>
+#include <cmath>
+
+namespace {
+
+constexpr double kDotRadius = 4.0;
+constexpr double kSwatch = 10.0;
+constexpr double kPadding = 6.0;
+constexpr double kOffset = 14.0;
+
+} // namespace
+
+CrosshairLayer::CrosshairLayer(QGraphicsItem *parent)
+    : QGraphicsItem(parent)
+{
+    // Above the series, markers and the curve layer
+    setZValue(12.0);
+    setAcceptedMouseButtons(Qt::NoButton);
+}
+
+void CrosshairLayer::setView(const QRectF &world, const QRectF &plotArea)
+{
+    hideCursor();
+    if (plotArea != m_plotArea)
+        prepareGeometryChange();
+    m_world = world;
+    m_plotArea = plotArea;
+}
+
+void CrosshairLayer::setCursor(const QPointF &cursor, const QVector<CrosshairReading> &readings, int hidden)
+{
+    invalidate();
+    m_visible = true;
+    m_cursor = cursor;
+    m_readings = readings;
+    m_hidden = hidden + qMax(0, int(readings.size()) - MaxReadings);
+    invalidate();
+}
+
+void CrosshairLayer::hideCursor()
+{
+    if (!m_visible)
+        return;
+    invalidate();
+    m_visible = false;
+    m_readings.clear();
+    m_hidden = 0;
+}
+
+void CrosshairLayer::setColor(const QColor &color)
+{
+    m_color = color;
+    invalidate();
+}
+
+QPointF CrosshairLayer::toChart(const QPointF &world) const
+{
+    return QPointF(m_plotArea.left() + (world.x() - m_world.left()) / m_world.width() * m_plotArea.width(),
+                   m_plotArea.bottom() - (world.y() - m_world.top()) / m_world.height() * m_plotArea.height());
+}
+
+QStringList CrosshairLayer::readoutLines() const
+{
+    QStringList lines;
+    lines << QString("x = %1, y = %2").arg(m_cursor.x(), 0, 'g', 8).arg(m_cursor.y(), 0, 'g', 8);
+    const int shown = qMin(int(m_readings.size()), MaxReadings);
+    for (int i = 0; i < shown; i++)
+        lines << m_readings[i].text;
+    if (m_hidden > 0)
+        lines << QString("+%1 more").arg(m_hidden);
+    return lines;
+}
+
+QRectF CrosshairLayer::readoutRect() const
+{
+    const QFontMetricsF metrics(m_font);
+    double width = 0.0;
+    const QStringList lines = readoutLines();
+    for (const QString &line : lines)
+        width = qMax(width, metrics.horizontalAdvance(line));
+    const QSizeF size(width + kSwatch + 3 * kPadding, lines.size() * metrics.height() + 2 * kPadding);
+
+    // Below right of the cursor, flipped to stay inside the plot area
+    const QPointF c = toChart(m_cursor);
+    QPointF topLeft(c.x() + kOffset, c.y() + kOffset);
+    if (topLeft.x() + size.width() > m_plotArea.right())
+        topLeft.setX(c.x() - kOffset - size.width());
+    if (topLeft.y() + size.height() > m_plotArea.bottom())
+        topLeft.setY(c.y() - kOffset - size.height());
+    return QRectF(topLeft, size);
+}
+
+void CrosshairLayer::invalidate()
+{
+    if (!m_visible || m_world.isEmpty() || m_plotArea.isEmpty())
+        return;
+
+    // Only the pixels the crosshair covers, with a margin for antialiasing
+    const QPointF c = toChart(m_cursor);
+    update(QRectF(c.x() - 2.0, m_plotArea.top(), 4.0, m_plotArea.height()));
+    update(QRectF(m_plotArea.left(), c.y() - 2.0, m_plotArea.width(), 4.0));
+    const int shown = qMin(int(m_readings.size()), MaxReadings);
+    const double dot = kDotRadius + 2.0;
+    for (int i = 0; i < shown; i++) {
+        const QPointF p = toChart(m_readings[i].point);
+        update(QRectF(p.x() - dot, p.y() - dot, 2 * dot, 2 * dot));
+    }
+    update(readoutRect().adjusted(-1.0, -1.0, 1.0, 1.0));
+}
+
+QRectF CrosshairLayer::boundingRect() const
+{
+    return m_plotArea;
+}
+
+void CrosshairLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    if (!m_visible || m_world.isEmpty() || m_plotArea.isEmpty())
+        return;
+
+    painter->save();
+    painter->setClipRect(m_plotArea);
+
+    // Dashed hairlines through the cursor
+    const QPointF c = toChart(m_cursor);
+    QPen line(m_color, 0.0, Qt::DashLine);
+    line.setCosmetic(true);
+    painter->setPen(line);
+    painter->drawLine(QPointF(c.x(), m_plotArea.top()), QPointF(c.x(), m_plotArea.bottom()));
+    painter->drawLine(QPointF(m_plotArea.left(), c.y()), QPointF(m_plotArea.right(), c.y()));
+
+    // A dot on each listed curve
+    painter->setRenderHint(QPainter::Antialiasing);
+    const int shown = qMin(int(m_readings.size()), MaxReadings);
+    for (int i = 0; i < shown; i++) {
+        const QPointF p = toChart(m_readings[i].point);
+        if (!std::isfinite(p.x()) || !std::isfinite(p.y()))
+            continue;
+        painter->setPen(QPen(m_color, 1.0));
+        painter->setBrush(m_readings[i].color);
+        painter->drawEllipse(p, kDotRadius, kDotRadius);
+    }
+
+    // Readout box, one colour swatch per curve line
+    const QRectF box = readoutRect();
+    const QStringList lines = readoutLines();
+    const QFontMetricsF metrics(m_font);
+    painter->setFont(m_font);
+    painter->setPen(QPen(m_color, 1.0));
+    painter->setBrush(QColor(0, 0, 0, 190));
+    painter->drawRoundedRect(box, 4.0, 4.0);
+
+    double y = box.top() + kPadding;
+    const double textX = box.left() + 2 * kPadding + kSwatch;
+    for (int i = 0; i < lines.size(); i++) {
+        if (i > 0 && i <= shown) {
+            const QRectF swatch(box.left() + kPadding, y + (metrics.height() - kSwatch) / 2, kSwatch, kSwatch);
+            painter->fillRect(swatch, m_readings[i - 1].color);
+        }
+        painter->setPen(m_color);
+        painter->drawText(QPointF(textX, y + metrics.ascent()), lines[i]);
+        y += metrics.height();
+    }
+    painter->restore();
+}
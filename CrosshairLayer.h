@@ -0,0 +1,62 @@
+// CrosshairLayer.h
+#ifndef CROSSHAIRLAYER_H
+#define CROSSHAIRLAYER_H
+
+#include <QColor>
+#include <QFont>
+#include <QGraphicsItem>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One line of the crosshair readout, with the world point it marks
+struct CrosshairReading {
+    QString text;
+    QColor color;
+    QPointF point;
+};
+
+// Graphics item drawing a crosshair at the cursor with a readout box of the
+// values under it. Moving the cursor only invalidates the old and new line
+// strips, dots and box, so the chart's series are repainted in a few thin
+// rectangles instead of the whole plot area on every mouse move.
+class CrosshairLayer : public QGraphicsItem
+{
+public:
+    static constexpr int MaxReadings = 8;
+
+    explicit CrosshairLayer(QGraphicsItem *parent = nullptr);
+
+    // World rectangle shown by the axes (y = top..bottom with top < bottom) and
+    // the plot area it maps to in chart coordinates, hides the crosshair
+    void setView(const QRectF &world, const QRectF &plotArea);
+
+    // Cursor in world coordinates and the readings to list, nearest first. At
+    // most MaxReadings are shown, hidden counts further ones left out by the caller.
+    void setCursor(const QPointF &cursor, const QVector<CrosshairReading> &readings, int hidden = 0);
+    void hideCursor();
+
+    void setColor(const QColor &color);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+    QPointF toChart(const QPointF &world) const;
+    QStringList readoutLines() const;
+    QRectF readoutRect() const;
+    void invalidate();
+
+    QRectF m_world;
+    QRectF m_plotArea;
+    bool m_visible = false;
+    QPointF m_cursor;
+    QVector<CrosshairReading> m_readings;
+    int m_hidden = 0;
+    QColor m_color = Qt::white;
+    QFont m_font;
+};
+
+#endif
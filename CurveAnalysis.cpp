@@ -0,0 +1,261 @@
+#include "CurveAnalysis.h"
+#include "Arena.h"
+#include <QtConcurrent>
+
+namespace {
+
+bool crosses(double a, double b)
+{
+    return (a < 0.0) != (b < 0.0);
+}
+
+// Indices i where v[i] and v[i + 1] differ in sign. The flag pass has no
+// branches so the compiler can vectorize it, the gather pass is sparse.
+QVector<int> signChanges(const double *v, int n)
+{
+    QVector<int> brackets;
+    if (n < 2)
+        return brackets;
+
+    Arena::Scope scope(Arena::threadLocal());
+    unsigned char *flags = Arena::threadLocal().allocateArray<unsigned char>(n - 1);
+    for (int i = 0; i < n - 1; i++) {
+        const bool finite = std::isfinite(v[i]) & std::isfinite(v[i + 1]);
+        flags[i] = finite & ((v[i] < 0.0) != (v[i + 1] < 0.0));
+    }
+    for (int i = 0; i < n - 1; i++) {
+        if (flags[i])
+            brackets.append(i);
+    }
+    return brackets;
+}
+
+// Cached values as doubles, converted into arena scratch when stored as float
+const double *channelValues(const SampleChannel &channel)
+{
+    if (const double *values = channel.doubleData())
+        return values;
+
+    double *values = Arena::threadLocal().allocateArray<double>(channel.count());
+    channel.load(values, 0, channel.count());
+    return values;
+}
+
+// Values of a curve at first + i * step in arena scratch, from its expression
+// when it has one, otherwise interpolated linearly between its samples
+const double *resample(const AnalysisCurve &curve, double first, double step, int n)
+{
+    double *values = Arena::threadLocal().allocateArray<double>(n);
+    if (curve.expression && curve.expression->isValid()) {
+        double *xs = Arena::threadLocal().allocateArray<double>(n);
+        for (int i = 0; i < n; i++)
+            xs[i] = first + i * step;
+        ExpressionBindings bindings = curve.bindings;
+        bindings.streams[0] = xs;
+        curve.expression->evaluateBatch(bindings, values, n);
+        return values;
+    }
+
+    const SampleCache &s = *curve.samples;
+    const double *y = channelValues(s.y);
+    const int last = s.count() - 1;
+    for (int i = 0; i < n; i++) {
+        const double t = (first + i * step - s.xMin) / s.step;
+        const int k = std::clamp(int(std::floor(t)), 0, std::max(0, last - 1));
+        const double frac = std::min(t - k, 1.0);
+        values[i] = last > 0 ? y[k] + (y[k + 1] - y[k]) * frac : y[0];
+    }
+    return values;
+}
+
+double valueAt(const AnalysisCurve &curve, double x)
+{
+    ExpressionBindings bindings = curve.bindings;
+    bindings.values[0] = x;
+    return curve.expression->evaluate(bindings);
+}
+
+double slopeAt(const AnalysisCurve &curve, double x)
+{
+    ExpressionBindings bindings = curve.bindings;
+    bindings.values[0] = x;
+    return curve.expression->evaluateJet(bindings, 0).d;
+}
+
+// Polish a bracket with Brent's method. Brackets around poles converge to the
+// pole itself, those are rejected because the residual doesn't vanish there.
+template <typename F>
+bool refine(F g, double a, double b, double &x)
+{
+    const double ga = g(a);
+    const double gb = g(b);
+    if (!std::isfinite(ga) || !std::isfinite(gb) || !crosses(ga, gb))
+        return false;
+
+    x = CurveAnalysis::brent(g, a, b, ga, gb, 1e-12 * (b - a));
+    const double residual = g(x);
+    return std::isfinite(residual) && std::fabs(residual) <= 1e-6 * (1.0 + std::max(std::fabs(ga), std::fabs(gb)));
+}
+
+double interpolateZero(double a, double b, double ga, double gb)
+{
+    return ga == gb ? a : a - ga * (b - a) / (gb - ga);
+}
+
+} // namespace
+
+void CurveAnalysis::findRootsAndExtrema(const AnalysisCurve &curve, QVector<CurveFeature> &out)
+{
+    const SampleCache &s = *curve.samples;
+    Arena::Scope scope(Arena::threadLocal());
+    const double *y = channelValues(s.y);
+    const int n = s.count();
+    const bool expr = curve.expression && curve.expression->isValid();
+
+    // Roots from sign changes of f
+    for (int i : signChanges(y, n)) {
+        const double a = s.xAt(i), b = s.xAt(i + 1);
+        double x = interpolateZero(a, b, y[i], y[i + 1]);
+        if (expr && !refine([&curve](double t) { return valueAt(curve, t); }, a, b, x))
+            continue;
+        out.append({ FeatureKind::Root, x, 0.0, curve.index, -1 });
+    }
+
+    // Extrema from sign changes of f', exact slopes when they were sampled
+    if (!s.dy.isEmpty()) {
+        const double *dy = channelValues(s.dy);
+        for (int i : signChanges(dy, n)) {
+            const double a = s.xAt(i), b = s.xAt(i + 1);
+            double x = interpolateZero(a, b, dy[i], dy[i + 1]);
+            if (expr && !refine([&curve](double t) { return slopeAt(curve, t); }, a, b, x))
+                continue;
+            const double fx = expr ? valueAt(curve, x) : y[i] + (y[i + 1] - y[i]) * (x - a) / (b - a);
+            if (std::isfinite(fx))
+                out.append({ dy[i] > 0.0 ? FeatureKind::Maximum : FeatureKind::Minimum, x, fx, curve.index, -1 });
+        }
+        return;
+    }
+
+    // Otherwise from sign changes of the sample differences
+    if (n < 3)
+        return;
+    double *diff = Arena::threadLocal().allocateArray<double>(n - 1);
+    for (int i = 0; i < n - 1; i++)
+        diff[i] = y[i + 1] - y[i];
+
+    for (int k : signChanges(diff, n - 1)) {
+        const FeatureKind kind = diff[k] > 0.0 ? FeatureKind::Maximum : FeatureKind::Minimum;
+        const double y0 = y[k], y1 = y[k + 1], y2 = y[k + 2];
+        double x = s.xAt(k + 1);
+        double fx = y1;
+
+        if (expr) {
+            double refined;
+            if (refine([&curve](double t) { return slopeAt(curve, t); }, s.xAt(k), s.xAt(k + 2), refined)) {
+                x = refined;
+                fx = valueAt(curve, x);
+            } else if (!std::isfinite(slopeAt(curve, x))) {
+                continue;
+            }
+        } else {
+            // Vertex of the parabola through the three samples
+            const double curvature = y0 - 2.0 * y1 + y2;
+            if (curvature != 0.0) {
+                x += 0.5 * s.step * (y0 - y2) / curvature;
+                fx = y1 - (y0 - y2) * (y0 - y2) / (8.0 * curvature);
+            }
+        }
+
+        if (std::isfinite(fx))
+            out.append({ kind, x, fx, curve.index, -1 });
+    }
+}
+
+void CurveAnalysis::findIntersections(const AnalysisCurve &a, const AnalysisCurve &b, QVector<CurveFeature> &out)
+{
+    const SampleCache &sa = *a.samples;
+    const SampleCache &sb = *b.samples;
+    Arena::Scope scope(Arena::threadLocal());
+
+    // Curves on different grids, e.g. one drawn from its pyramid with an older
+    // grid, are compared on the finer of the two over the range both cover
+    double first = sa.xMin;
+    double step = sa.step;
+    int n = sa.count();
+    const double *ya;
+    const double *yb;
+    if (sa.sameGrid(sb)) {
+        ya = channelValues(sa.y);
+        yb = channelValues(sb.y);
+    } else {
+        first = std::max(sa.xMin, sb.xMin);
+        const double last = std::min(sa.xAt(sa.count() - 1), sb.xAt(sb.count() - 1));
+        step = std::min(sa.step, sb.step);
+        if (!(last > first) || !(step > 0.0))
+            return;
+        n = int(std::floor((last - first) / step + 1e-9)) + 1;
+        ya = resample(a, first, step, n);
+        yb = resample(b, first, step, n);
+    }
+
+    double *diff = Arena::threadLocal().allocateArray<double>(n);
+    for (int i = 0; i < n; i++)
+        diff[i] = ya[i] - yb[i];
+
+    const bool exact = a.expression && a.expression->isValid() && b.expression && b.expression->isValid();
+
+    for (int i : signChanges(diff, n)) {
+        const double x0 = first + i * step, x1 = first + (i + 1) * step;
+        double x = interpolateZero(x0, x1, diff[i], diff[i + 1]);
+        double y = ya[i] + (ya[i + 1] - ya[i]) * (x - x0) / (x1 - x0);
+
+        if (exact) {
+            if (!refine([&a, &b](double t) { return valueAt(a, t) - valueAt(b, t); }, x0, x1, x))
+                continue;
+            y = valueAt(a, x);
+        }
+        out.append({ FeatureKind::Intersection, x, y, a.index, b.index });
+    }
+}
+
+QVector<CurveFeature> CurveAnalysis::findFeatures(const QVector<AnalysisCurve> &curves, int *skippedPairs)
+{
+    // One task per curve, plus one per pair of curves for intersections
+    struct Task {
+        int a;
+        int b;
+        QVector<CurveFeature> found;
+    };
+    QVector<Task> tasks;
+    for (int i = 0; i < curves.size(); i++)
+        tasks.append({ i, -1, {} });
+    const bool pairs = curves.size() <= MaxIntersectionCurves;
+    if (pairs) {
+        for (int i = 0; i < curves.size(); i++) {
+            for (int j = i + 1; j < curves.size(); j++)
+                tasks.append({ i, j, {} });
+        }
+    }
+    if (skippedPairs)
+        *skippedPairs = pairs ? 0 : int(qint64(curves.size()) * (curves.size() - 1) / 2);
+
+    QtConcurrent::blockingMap(tasks, [&curves](Task &task) {
+        if (task.b < 0)
+            findRootsAndExtrema(curves[task.a], task.found);
+        else
+            findIntersections(curves[task.a], curves[task.b], task.found);
+    });
+
+    QVector<CurveFeature> features;
+    for (const Task &task : tasks)
+        features += task.found;
+
+    std::sort(features.begin(), features.end(), [](const CurveFeature &l, const CurveFeature &r) {
+        if (l.curve != r.curve)
+            return l.curve < r.curve;
+        if (l.other != r.other)
+            return l.other < r.other;
+        return l.x < r.x;
+    });
+    return features;
+}
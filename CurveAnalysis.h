@@ -0,0 +1,121 @@
+// CurveAnalysis.h
+#ifndef CURVEANALYSIS_H
+#define CURVEANALYSIS_H
+
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include "ExpressionEngine.h"
+#include "SampleCache.h"
+
+enum class FeatureKind {
+    Root,
+    Maximum,
+    Minimum,
+    Intersection
+};
+
+// A point of interest found on one curve, or between two for intersections
+struct CurveFeature {
+    FeatureKind kind;
+    double x;
+    double y;
+    int curve;
+    int other;   // second curve of an intersection, -1 otherwise
+};
+
+// A sampled curve to analyse. The expression refines brackets found in the
+// samples; when it is invalid the samples are interpolated instead. Slot 0
+// of the expression is x, bindings holds the values of any other slots.
+struct AnalysisCurve {
+    int index;
+    const CompiledExpression *expression;
+    const SampleCache *samples;
+    ExpressionBindings bindings;
+};
+
+// Finds roots, local extrema and pairwise intersections. Candidates come from
+// sign changes in the cached samples (or their slopes), scanned in parallel
+// per curve and per pair, and each bracket is then polished with Brent's
+// method on the compiled expression.
+class CurveAnalysis
+{
+public:
+    // Intersections are only searched when at most this many curves are given,
+    // beyond that the number of pairs left out goes to skippedPairs
+    static constexpr int MaxIntersectionCurves = 64;
+
+    static QVector<CurveFeature> findFeatures(const QVector<AnalysisCurve> &curves, int *skippedPairs = nullptr);
+
+    // Brent's root finder on [a, b] where fa and fb have opposite signs
+    template <typename F>
+    static double brent(F f, double a, double b, double fa, double fb, double tolerance, int maxIterations = 80);
+
+private:
+    static void findRootsAndExtrema(const AnalysisCurve &curve, QVector<CurveFeature> &out);
+    static void findIntersections(const AnalysisCurve &a, const AnalysisCurve &b, QVector<CurveFeature> &out);
+};
+
+template <typename F>
+double CurveAnalysis::brent(F f, double a, double b, double fa, double fb, double tolerance, int maxIterations)
+{
+    if (fa == 0.0)
+        return a;
+    if (fb == 0.0)
+        return b;
+
+    double c = b, fc = fb;
+    double d = b - a, e = d;
+    for (int iter = 0; iter < maxIterations; iter++) {
+        if ((fb > 0.0) == (fc > 0.0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (std::fabs(fc) < std::fabs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+
+        const double tol1 = 2.0 * 2.2e-16 * std::fabs(b) + 0.5 * tolerance;
+        const double xm = 0.5 * (c - b);
+        if (std::fabs(xm) <= tol1 || fb == 0.0)
+            return b;
+
+        if (std::fabs(e) >= tol1 && std::fabs(fa) > std::fabs(fb)) {
+            // Inverse quadratic interpolation, or secant when only two points differ
+            double p, q;
+            const double s = fb / fa;
+            if (a == c) {
+                p = 2.0 * xm * s;
+                q = 1.0 - s;
+            } else {
+                const double qa = fa / fc, r = fb / fc;
+                p = s * (2.0 * xm * qa * (qa - r) - (b - a) * (r - 1.0));
+                q = (qa - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0)
+                q = -q;
+            p = std::fabs(p);
+            if (2.0 * p < std::min(3.0 * xm * q - std::fabs(tol1 * q), std::fabs(e * q))) {
+                e = d;
+                d = p / q;
+            } else {
+                d = xm;
+                e = d;
+            }
+        } else {
+            // Fall back to bisection
+            d = xm;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+        b += std::fabs(d) > tol1 ? d : (xm > 0.0 ? tol1 : -tol1);
+        fb = f(b);
+    }
+    return b;
+}
+
+#endif
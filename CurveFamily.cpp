@@ -0,0 +1,124 @@
+#include "CurveFamily.h"
+#include "ColorMap.h"
+#include <QPainter>
+#include <QPolygonF>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <cmath>
+
+bool CurveFamily::sweep(const CompiledExpression &expression, int slot, const ExpressionBindings &bindings,
+                        double from, double to, double step, double xMin, double xStep, int points,
+                        QString *error)
+{
+    QString message;
+    if (!expression.isValid())
+        message = "The equation could not be compiled";
+    else if (slot <= 0 || slot >= expression.variables().size())
+        message = "The equation doesn't use this parameter";
+    else if (step <= 0.0 || to < from)
+        message = "The sweep range is empty";
+    else if (points < 2)
+        message = "At least two points are needed";
+
+    const double span = (to - from) / step;
+    if (message.isEmpty() && span + 1.0 > MaxCurves)
+        message = QString("A sweep is limited to %1 curves").arg(MaxCurves);
+
+    if (!message.isEmpty()) {
+        if (error)
+            *error = message;
+        return false;
+    }
+
+    // Tolerate rounding so that 0..10 step 0.1 includes 10
+    m_curves = int(std::floor(span + 1e-9)) + 1;
+    m_points = points;
+    m_from = from;
+    m_step = step;
+    m_xMin = xMin;
+    m_xStep = xStep;
+    m_values.resize(qsizetype(m_curves) * m_points);
+
+    SampleBuffer xs(points);
+    for (int j = 0; j < points; j++)
+        xs[j] = xAt(j);
+
+    // Every variant is an independent batch over the same x values
+    QVector<int> rows(m_curves);
+    for (int i = 0; i < m_curves; i++)
+        rows[i] = i;
+
+    const double *x = xs.constData();
+    double *values = m_values.data();
+    QtConcurrent::blockingMap(rows, [&](int row) {
+        ExpressionBindings local = bindings;
+        local.streams[0] = x;
+        local.streams[slot] = nullptr;
+        local.values[slot] = parameterAt(row);
+        expression.evaluateBatch(local, values + qsizetype(row) * m_points, m_points);
+    });
+    return true;
+}
+
+void CurveFamily::clear()
+{
+    m_values.clear();
+    m_curves = 0;
+    m_points = 0;
+}
+
+QImage CurveFamily::render(const QRectF &world, const QSize &pixels) const
+{
+    QImage image(pixels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    if (isEmpty() || pixels.isEmpty() || world.isEmpty())
+        return image;
+
+    const double sx = pixels.width() / world.width();
+    const double sy = pixels.height() / world.height();
+    const QVector<QRgb> &lut = ColorMap::viridis();
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // Points are emitted in runs of finite values, gaps break the line
+    QPolygonF line;
+    line.reserve(m_points);
+    for (int i = 0; i < m_curves; i++) {
+        const int shade = m_curves > 1 ? i * 255 / (m_curves - 1) : 0;
+        painter.setPen(QPen(QColor(lut[shade]), 1.0));
+
+        const double *ys = curve(i);
+        for (int j = 0; j <= m_points; j++) {
+            if (j < m_points && std::isfinite(ys[j])) {
+                line.append(QPointF((xAt(j) - world.left()) * sx, (world.bottom() - ys[j]) * sy));
+                continue;
+            }
+            if (line.size() > 1)
+                painter.drawPolyline(line);
+            line.clear();
+        }
+    }
+    return image;
+}
+
+bool CurveFamily::writeCsv(QIODevice *device, const QString &parameterName) const
+{
+    if (isEmpty() || !device->isWritable())
+        return false;
+
+    QTextStream out(device);
+    out << "x";
+    for (int i = 0; i < m_curves; i++)
+        out << "," << parameterName << "=" << QString::number(parameterAt(i), 'g', 10);
+    out << "\n";
+
+    for (int j = 0; j < m_points; j++) {
+        out << QString::number(xAt(j), 'g', 17);
+        for (int i = 0; i < m_curves; i++)
+            out << "," << QString::number(curve(i)[j], 'g', 17);
+        out << "\n";
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
@@ -0,0 +1,53 @@
+// CurveFamily.h
+#ifndef CURVEFAMILY_H
+#define CURVEFAMILY_H
+
+#include <QImage>
+#include <QIODevice>
+#include <QRectF>
+#include <QSize>
+#include "ExpressionEngine.h"
+#include "SampleBufferPool.h"
+
+// Family of curves y = f(x; p) for one parameter p swept over a range. All
+// variants are evaluated as one parallel batch into a row-major matrix, one
+// row per parameter value, and drawn together into a single image with a
+// colour gradient instead of one chart series per curve.
+class CurveFamily
+{
+public:
+    static constexpr int MaxCurves = 2000;
+
+    // Sample the expression at points x values from xMin with spacing xStep,
+    // once per value of the variable in slot, from..to in steps of step.
+    // Slot 0 is x, bindings holds the values of the other slots.
+    bool sweep(const CompiledExpression &expression, int slot, const ExpressionBindings &bindings,
+               double from, double to, double step, double xMin, double xStep, int points,
+               QString *error = nullptr);
+    void clear();
+
+    bool isEmpty() const { return m_curves == 0; }
+    int curveCount() const { return m_curves; }
+    int pointCount() const { return m_points; }
+    double parameterAt(int curve) const { return m_from + curve * m_step; }
+    double xAt(int point) const { return m_xMin + point * m_xStep; }
+    const double *curve(int curve) const { return m_values.constData() + qsizetype(curve) * m_points; }
+
+    // Draw every curve of the family over the world rectangle (y = top..bottom
+    // with top < bottom), coloured from the first to the last parameter value
+    QImage render(const QRectF &world, const QSize &pixels) const;
+
+    // Write the matrix as CSV: an x column followed by one column per curve
+    bool writeCsv(QIODevice *device, const QString &parameterName) const;
+
+private:
+    SampleBuffer m_values;
+    int m_curves = 0;
+    int m_points = 0;
+    double m_from = 0.0;
+    double m_step = 0.0;
+    double m_xMin = 0.0;
+    double m_xStep = 0.0;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "CurveLayer.h"
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QTransform>
+
+CurveLayer::CurveLayer(QGraphicsItem *parent)
+    : QGraphicsItem(parent)
+{
+    // Level of the chart's own series, above shades, grid and axes
+    setZValue(4.0);
+}
+
+void CurveLayer::setCurve(const QString &name, const QPen &pen, const SegmentedCurve &points)
+{
+    Curve curve;
+    curve.name = name;
+    curve.pen = pen;
+    curve.pen.setCosmetic(true);
+    curve.points = points;
+
+    const auto it = m_index.constFind(name);
+    if (it != m_index.constEnd()) {
+        m_batchesDirty = m_batchesDirty || m_curves[*it].pen != curve.pen;
+        m_curves[*it] = curve;
+    } else {
+        m_index.insert(name, int(m_curves.size()));
+        m_curves.append(curve);
+        m_batchesDirty = true;
+    }
+    update();
+}
+
+void CurveLayer::removeCurve(const QString &name)
+{
+    const int row = m_index.value(name, -1);
+    if (row < 0)
+        return;
+
+    // Move the last curve into the hole
+    const int last = int(m_curves.size()) - 1;
+    if (row != last) {
+        m_curves[row] = m_curves[last];
+        m_index[m_curves[row].name] = row;
+    }
+    m_curves.removeLast();
+    m_index.remove(name);
+    m_batchesDirty = true;
+    update();
+}
+
+void CurveLayer::clear()
+{
+    m_curves.clear();
+    m_index.clear();
+    m_batches.clear();
+    m_batchesDirty = false;
+    update();
+}
+
+void CurveLayer::setView(const QRectF &world, const QRectF &plotArea)
+{
+    if (plotArea != m_plotArea)
+        prepareGeometryChange();
+    m_world = world;
+    m_plotArea = plotArea;
+    update();
+}
+
+void CurveLayer::setCurvesVisible(bool visible)
+{
+    m_curvesVisible = visible;
+    update();
+}
+
+void CurveLayer::setLegendVisible(bool visible)
+{
+    m_legendVisible = visible;
+    update();
+}
+
+void CurveLayer::setLegendColor(const QColor &color)
+{
+    m_legendColor = color;
+    update();
+}
+
+QRectF CurveLayer::boundingRect() const
+{
+    return m_plotArea;
+}
+
+void CurveLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    if (m_curves.isEmpty() || m_world.isEmpty() || m_plotArea.isEmpty())
+        return;
+
+    if (m_curvesVisible)
+        paintCurves(painter);
+    if (m_legendVisible)
+        paintLegend(painter);
+}
+
+void CurveLayer::paintCurves(QPainter *painter)
+{
+    // Group curves by pen, there are only a handful of distinct pens
+    if (m_batchesDirty) {
+        m_batches.clear();
+        for (int i = 0; i < m_curves.size(); i++) {
+            int batch = 0;
+            while (batch < m_batches.size() && m_curves[m_batches[batch].first()].pen != m_curves[i].pen)
+                batch++;
+            if (batch == m_batches.size())
+                m_batches.append(QVector<int>());
+            m_batches[batch].append(i);
+        }
+        m_batchesDirty = false;
+    }
+
+    // World to chart coordinates, y grows downwards on screen
+    const double sx = m_plotArea.width() / m_world.width();
+    const double sy = m_plotArea.height() / m_world.height();
+    QTransform transform(sx, 0.0, 0.0, -sy, m_plotArea.left() - m_world.left() * sx,
+                         m_plotArea.top() + m_world.bottom() * sy);
+
+    painter->save();
+    painter->setClipRect(m_plotArea);
+    painter->setTransform(transform, true);
+
+    // One pen change per batch, cosmetic pens keep their pixel width under the transform
+    for (const QVector<int> &batch : m_batches) {
+        painter->setPen(m_curves[batch.first()].pen);
+        for (int i : batch) {
+            const SegmentedCurve &curve = m_curves[i].points;
+            const QPointF *points = curve.points().constData();
+            for (int k = 0; k < curve.segmentCount(); k++) {
+                const int begin = curve.segmentBegin(k);
+                const int length = curve.segmentEnd(k) - begin;
+                if (length == 1)
+                    painter->drawPoint(points[begin]);
+                else
+                    painter->drawPolyline(points + begin, length);
+            }
+        }
+    }
+    painter->restore();
+}
+
+void CurveLayer::paintLegend(QPainter *painter)
+{
+    const int shown = qMin(int(m_curves.size()), MaxLegendEntries);
+    const int hidden = int(m_curves.size()) - shown;
+    const QFontMetricsF metrics(painter->font());
+    const double line = metrics.height();
+    const double swatch = 16.0;
+
+    painter->save();
+    double y = m_plotArea.top() + 6.0;
+    const double x = m_plotArea.left() + 8.0;
+    for (int i = 0; i < shown; i++) {
+        const Curve &curve = m_curves[i];
+        painter->setPen(curve.pen);
+        painter->drawLine(QPointF(x, y + line / 2), QPointF(x + swatch, y + line / 2));
+        painter->setPen(m_legendColor);
+        painter->drawText(QPointF(x + swatch + 6.0, y + metrics.ascent()), curve.name);
+        y += line;
+    }
+    if (hidden > 0) {
+        painter->setPen(m_legendColor);
+        painter->drawText(QPointF(x + swatch + 6.0, y + metrics.ascent()), QString("+%1 more").arg(hidden));
+    }
+    painter->restore();
+}
@@ -0,0 +1,68 @@
+// CurveLayer.h
+#ifndef CURVELAYER_H
+#define CURVELAYER_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPen>
+#include <QString>
+#include <QVector>
+#include "SegmentedCurve.h"
+
+// Graphics item that draws any number of curves itself, as an alternative to
+// one QLineSeries per curve. Points are kept in world coordinates and mapped
+// to the plot area with a single transform, so panning and zooming don't
+// touch them. Curves sharing a pen are drawn as one batch, and the legend is
+// only laid out when painted and capped with a "+N more" entry.
+class CurveLayer : public QGraphicsItem
+{
+public:
+    static constexpr int MaxLegendEntries = 8;
+
+    explicit CurveLayer(QGraphicsItem *parent = nullptr);
+
+    // Add or replace the curve called name, each segment is drawn as one polyline
+    void setCurve(const QString &name, const QPen &pen, const SegmentedCurve &points);
+    void removeCurve(const QString &name);
+    bool hasCurve(const QString &name) const { return m_index.contains(name); }
+    int curveCount() const { return int(m_curves.size()); }
+    void clear();
+
+    // World rectangle shown by the axes (y = top..bottom with top < bottom) and
+    // the plot area it maps to in chart coordinates
+    void setView(const QRectF &world, const QRectF &plotArea);
+
+    void setLegendVisible(bool visible);
+    void setLegendColor(const QColor &color);
+
+    // Curves for exporters that draw them on their own, with setCurvesVisible(false)
+    // the layer then only paints its legend
+    const QPen &curvePen(int row) const { return m_curves[row].pen; }
+    const SegmentedCurve &curvePoints(int row) const { return m_curves[row].points; }
+    void setCurvesVisible(bool visible);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+    struct Curve {
+        QString name;
+        QPen pen;
+        SegmentedCurve points;
+    };
+
+    void paintCurves(QPainter *painter);
+    void paintLegend(QPainter *painter);
+
+    QVector<Curve> m_curves;
+    QHash<QString, int> m_index;
+    QVector<QVector<int>> m_batches;   // curve indices grouped by pen, rebuilt lazily
+    bool m_batchesDirty = false;
+    QRectF m_world;
+    QRectF m_plotArea;
+    bool m_curvesVisible = true;
+    bool m_legendVisible = true;
+    QColor m_legendColor = Qt::white;
+};
+
+#endif
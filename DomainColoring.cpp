@@ -0,0 +1,102 @@
+#include "DomainColoring.h"
+#include "SampleBufferPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+bool DomainColoring::setExpression(const QString &source, const QStringList &parameters, QString *error)
+{
+    m_tiles.clear();
+    m_parameters.fill(0.0, parameters.size());
+    return m_expr.compile(source, QStringList{ "z", "i" } + parameters, error);
+}
+
+void DomainColoring::setParameters(const QVector<double> &values)
+{
+    if (values == m_parameters)
+        return;
+    m_parameters = values;
+    m_tiles.clear();
+}
+
+QRgb DomainColoring::color(double re, double im)
+{
+    const double modulus = std::hypot(re, im);
+    if (!std::isfinite(modulus))
+        return 0;
+
+    // Hue from the argument, red on the positive real axis
+    double hue = std::atan2(im, re) * (3.0 / M_PI);
+    if (hue < 0.0)
+        hue += 6.0;
+
+    // Brightness ramps up within each band between powers of two of |w|
+    const double bands = std::log2(modulus);
+    const double value = std::isfinite(bands) ? 0.6 + 0.4 * (bands - std::floor(bands)) : 0.0;
+    const double saturation = 0.9;
+
+    const int sector = std::min(int(hue), 5);
+    const double f = hue - sector;
+    const double p = value * (1.0 - saturation);
+    const double q = value * (1.0 - saturation * f);
+    const double t = value * (1.0 - saturation * (1.0 - f));
+    double r, g, b;
+    switch (sector) {
+    case 0: r = value; g = t; b = p; break;
+    case 1: r = q; g = value; b = p; break;
+    case 2: r = p; g = value; b = t; break;
+    case 3: r = p; g = q; b = value; break;
+    case 4: r = t; g = p; b = value; break;
+    default: r = value; g = p; b = q; break;
+    }
+    return qRgb(int(r * 255.0 + 0.5), int(g * 255.0 + 0.5), int(b * 255.0 + 0.5));
+}
+
+void DomainColoring::computeTile(const TileKey &key, Tile &tile) const
+{
+    // The whole tile is one batch, z streams its real and imaginary parts
+    constexpr int TileSize = Tiles::TileSize;
+    constexpr int Lanes = TileSize * TileSize;
+    SampleBuffer xs(Lanes);
+    SampleBuffer ys(Lanes);
+    SampleBuffer wRe(Lanes);
+    SampleBuffer wIm(Lanes);
+    for (int v = 0; v < TileSize; v++) {
+        const double y = Tiles::y(key, v);
+        for (int u = 0; u < TileSize; u++) {
+            xs[v * TileSize + u] = Tiles::x(key, u);
+            ys[v * TileSize + u] = y;
+        }
+    }
+
+    ExpressionBindings re;
+    ExpressionBindings im;
+    re.streams[0] = xs.constData();
+    im.streams[0] = ys.constData();
+    im.values[1] = 1.0;
+    for (int k = 0; k < m_parameters.size() && 2 + k < ExpressionBindings::MaxSlots; k++)
+        re.values[2 + k] = m_parameters[k];
+    m_expr.evaluateBatchComplex(re, im, wRe.data(), wIm.data(), Lanes);
+
+    tile.pixels.resize(Lanes);
+    QRgb *dst = tile.pixels.data();
+    for (int k = 0; k < Lanes; k++)
+        dst[k] = color(wRe[k], wIm[k]);
+}
+
+QImage DomainColoring::render(const QRectF &world, const QSize &pixels)
+{
+    QImage image(pixels, QImage::Format_ARGB32_Premultiplied);
+    if (pixels.isEmpty() || world.isEmpty() || !m_expr.isValid()) {
+        image.fill(Qt::transparent);
+        return image;
+    }
+
+    m_tiles.update(world, pixels, [this](const TileKey &key, Tile &tile) { computeTile(key, tile); });
+
+    // The tiles are coloured already, their rows are copied as they are
+    m_tiles.forEachSpan(image, [](QRgb *line, const Tile &tile, int offset, int count) {
+        std::memcpy(line, tile.pixels.constData() + offset, count * sizeof(QRgb));
+    });
+    return image;
+}
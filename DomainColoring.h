@@ -0,0 +1,52 @@
+// DomainColoring.h
+#ifndef DOMAINCOLORING_H
+#define DOMAINCOLORING_H
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include "ExpressionEngine.h"
+#include "TileCache.h"
+
+// Renders a complex function w = f(z), z = x + iy, over a viewport by domain
+// colouring: the hue is arg w and the brightness steps up through each
+// doubling of |w|, so zeros and poles show as points where all hues meet.
+// Like HeatmapRenderer the tiles come from a TileCache. Each tile is one
+// batched complex evaluation and is coloured right away, since the colouring
+// needs no global range.
+class DomainColoring
+{
+public:
+    // Compile f(z) with i as the imaginary unit and the given free parameters after it
+    bool setExpression(const QString &source, const QStringList &parameters = QStringList(), QString *error = nullptr);
+    const CompiledExpression &expression() const { return m_expr; }
+
+    // Real values of the free parameters in setExpression order, changes drop the cached tiles
+    void setParameters(const QVector<double> &values);
+
+    // Render the world rectangle (x = left..right, y = top..bottom with top < bottom)
+    // into an image of the given pixel size
+    QImage render(const QRectF &world, const QSize &pixels);
+
+    void clearCache() { m_tiles.clear(); }
+    int lastComputedTiles() const { return m_tiles.lastComputed(); }
+    int lastVisibleTiles() const { return m_tiles.lastVisible(); }
+
+    // Colour of the value re + i*im, transparent when it isn't finite
+    static QRgb color(double re, double im);
+
+private:
+    struct Tile {
+        QVector<QRgb> pixels;
+    };
+    using Tiles = TileCache<Tile>;
+
+    void computeTile(const TileKey &key, Tile &tile) const;
+
+    CompiledExpression m_expr;
+    QVector<double> m_parameters;
+    Tiles m_tiles;
+};
+
+#endif
@@ -0,0 +1,350 @@
+// EngineTests.cpp
+// Differential checks of the expression engine, run by ctest. Exits with 1
+// when any check fails.
+#include "ExpressionEngine.h"
+#include "ExpressionJit.h"
+#include "FastMath.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJSEngine>
+#include <QRandomGenerator>
+#include <QVector>
+#include <QtDebug>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Distance between a and b in units in the last place of b
+double ulpDistance(double a, double b)
+{
+    if (a == b || (std::isnan(a) && std::isnan(b)))
+        return 0.0;
+    if (!std::isfinite(a) || !std::isfinite(b))
+        return std::numeric_limits<double>::infinity();
+    const double magnitude = std::fabs(b);
+    return std::fabs(a - b) / (std::nextafter(magnitude, std::numeric_limits<double>::infinity()) - magnitude);
+}
+
+// Bit for bit, so the sign of zero counts, any NaN equals any NaN
+bool sameValue(double a, double b)
+{
+    return (std::isnan(a) && std::isnan(b)) || std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// Random equation in x and a using every operator and function of the engine
+QString randomEquation(QRandomGenerator &random, int depth)
+{
+    static const char *const functions[] = { "sin", "cos", "tan", "sqrt", "abs", "log", "log10", "exp" };
+    static const char *const operators[] = { "+", "-", "*", "/" };
+
+    const int kind = random.bounded(10);
+    if (depth == 0 || kind < 2) {
+        switch (random.bounded(3)) {
+        case 0: return "x";
+        case 1: return "a";
+        default: return QString("(%1)").arg(random.bounded(-1000, 1000) / 100.0);
+        }
+    }
+    if (kind < 5)
+        return QString("%1(%2)").arg(QString(functions[random.bounded(8)]), randomEquation(random, depth - 1));
+    if (kind == 5)
+        return "-" + randomEquation(random, depth - 1);
+    if (kind == 6)
+        return QString("(%1)^%2").arg(randomEquation(random, depth - 1)).arg(random.bounded(4));
+
+    // Sequenced so the same seed gives the same equations with every compiler
+    const QString left = randomEquation(random, depth - 1);
+    const QString op = operators[random.bounded(4)];
+    const QString right = randomEquation(random, depth - 1);
+    return QString("(%1%2%3)").arg(left, op, right);
+}
+
+// Fast math against libm over dense samples, within the bounds FastMath.h
+// documents, and libm against the JavaScript Math.* results on a subset.
+// Prints the time each mode takes for the same samples.
+bool checkFastMath()
+{
+    struct Case {
+        const char *equation;
+        double from;
+        double to;
+        double maxUlp;
+    };
+    const Case cases[] = {
+        { "sin(x)", -100.0, 100.0, 2.0 },
+        { "sin(x)", -1e5, 1e5, 2.0 },
+        { "sin(x)", 1e5, 1e15, 2.0 },
+        { "cos(x)", -100.0, 100.0, 2.0 },
+        { "cos(x)", -1e5, 1e5, 2.0 },
+        { "cos(x)", -1e15, -1e5, 2.0 },
+        { "tan(x)", -1.5, 1.5, 4.0 },
+        { "tan(x)", -1e5, 1e5, 4.0 },
+        { "tan(x)", 1e5, 1e15, 4.0 },
+        { "exp(x)", -700.0, 700.0, 1.0 },
+        { "log(x)", 1e-3, 1e6, 1.0 },
+        { "log10(x)", 1e-3, 1e6, 2.0 },
+    };
+    constexpr int Samples = 4096;
+    constexpr int ReferenceStride = 16;
+    constexpr int Repeats = 100;
+    constexpr double ExactMaxUlp = 1.0;
+
+    QJSEngine js;
+    QVector<double> xs(Samples);
+    QVector<double> exact(Samples);
+    QVector<double> fast(Samples);
+    bool passed = true;
+
+    for (const Case &test : cases) {
+        CompiledExpression expression;
+        expression.compile(test.equation, { "x" });
+        for (int j = 0; j < Samples; j++)
+            xs[j] = test.from + (test.to - test.from) * j / (Samples - 1);
+        ExpressionBindings bindings;
+        bindings.streams[0] = xs.constData();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int r = 0; r < Repeats; r++)
+            expression.evaluateBatch(bindings, exact.data(), Samples, MathMode::Exact);
+        const double exactMs = timer.nsecsElapsed() / 1e6;
+        timer.restart();
+        for (int r = 0; r < Repeats; r++)
+            expression.evaluateBatch(bindings, fast.data(), Samples, MathMode::Fast);
+        const double fastMs = timer.nsecsElapsed() / 1e6;
+
+        double fastError = 0.0;
+        for (int j = 0; j < Samples; j++)
+            fastError = std::max(fastError, ulpDistance(fast[j], exact[j]));
+
+        const QString reference = QString("Math.") + test.equation;
+        double exactError = 0.0;
+        for (int j = 0; j < Samples; j += ReferenceStride) {
+            js.globalObject().setProperty("x", xs[j]);
+            exactError = std::max(exactError, ulpDistance(exact[j], js.evaluate(reference).toNumber()));
+        }
+
+        const bool ok = fastError <= test.maxUlp && exactError <= ExactMaxUlp;
+        passed = passed && ok;
+        qInfo().noquote() << QString("%1 %2 on [%3, %4]: fast %5 ULP (max %6), libm vs Math.* %7 ULP, %8 ms vs %9 ms")
+                                 .arg(QString(ok ? "PASS" : "FAIL"), QString(test.equation))
+                                 .arg(test.from).arg(test.to)
+                                 .arg(fastError).arg(test.maxUlp).arg(exactError)
+                                 .arg(fastMs, 0, 'f', 2).arg(exactMs, 0, 'f', 2);
+    }
+    qInfo().noquote() << QString("%1 x %2 samples per mode").arg(Repeats).arg(Samples);
+    return passed;
+}
+
+// Special values must give the libm results exactly, including signed zeros
+bool checkSpecialValues()
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inputs[] = { 0.0, -0.0, inf, -inf, nan };
+    constexpr int Count = int(sizeof(inputs) / sizeof(inputs[0]));
+
+    struct Function {
+        const char *name;
+        void (*fast)(double *, int);
+        double (*exact)(double);
+    };
+    const Function functions[] = {
+        { "sin", &FastMath::sin, [](double x) { return std::sin(x); } },
+        { "cos", &FastMath::cos, [](double x) { return std::cos(x); } },
+        { "tan", &FastMath::tan, [](double x) { return std::tan(x); } },
+        { "exp", &FastMath::exp, [](double x) { return std::exp(x); } },
+        { "log", &FastMath::log, [](double x) { return std::log(x); } },
+        { "log10", &FastMath::log10, [](double x) { return std::log10(x); } },
+    };
+
+    bool passed = true;
+    for (const Function &function : functions) {
+        double values[Count];
+        std::copy_n(inputs, Count, values);
+        function.fast(values, Count);
+        for (int i = 0; i < Count; i++) {
+            const double expected = function.exact(inputs[i]);
+            if (sameValue(values[i], expected))
+                continue;
+            passed = false;
+            qInfo().noquote() << QString("FAIL %1(%2): %3 instead of %4")
+                                     .arg(QString(function.name)).arg(inputs[i]).arg(values[i]).arg(expected);
+        }
+    }
+    if (passed)
+        qInfo().noquote() << "PASS special values";
+    return passed;
+}
+
+// Fused kernels against the interpreter lane by lane. Horner and repeated
+// squaring round differently from the program and std::pow, so each case has
+// a ULP bound; the ranges keep the polynomial terms from cancelling.
+bool checkShapes()
+{
+    struct Case {
+        const char *equation;
+        ExprShape shape;
+        double from;
+        double to;
+        double maxUlp;
+    };
+    const Case cases[] = {
+        { "2*x + 1", ExprShape::Polynomial, 0.0, 100.0, 1.0 },
+        { "x^3 + 2*x^2 + 3*x + 4", ExprShape::Polynomial, 0.0, 50.0, 4.0 },
+        { "3 - 2*x + 0.5*x^2 - a*x^3", ExprShape::Polynomial, -50.0, 0.0, 4.0 },
+        { "a*x^8 + x^5 + b*x + c", ExprShape::Polynomial, 1.0, 20.0, 8.0 },
+        { "x^2", ExprShape::Power, -1e3, 1e3, 1.0 },
+        { "x^3", ExprShape::Power, -1e3, 1e3, 2.0 },
+        { "x^5", ExprShape::Power, -100.0, 100.0, 4.0 },
+        { "x^7", ExprShape::Power, -100.0, 100.0, 6.0 },
+        { "x^8", ExprShape::Power, -100.0, 100.0, 6.0 },
+        { "a*sin(b*x+c)", ExprShape::Wave, -100.0, 100.0, 0.0 },
+        { "-2*cos(3*x - 1)", ExprShape::Wave, -100.0, 100.0, 0.0 },
+        { "sin(x)*b", ExprShape::Wave, -1e4, 1e4, 0.0 },
+    };
+    constexpr int Samples = 10001;
+
+    // Without the native code evaluateBatch takes the fused kernel
+    const bool jitEnabled = ExpressionJit::isEnabled();
+    ExpressionJit::setEnabled(false);
+
+    QVector<double> xs(Samples);
+    QVector<double> fused(Samples);
+    bool passed = true;
+
+    for (const Case &test : cases) {
+        CompiledExpression expression;
+        expression.compile(test.equation, { "x", "a", "b", "c" });
+        for (int j = 0; j < Samples; j++)
+            xs[j] = test.from + (test.to - test.from) * j / (Samples - 1);
+        ExpressionBindings bindings;
+        bindings.streams[0] = xs.constData();
+        bindings.values[1] = 1.37;
+        bindings.values[2] = -0.61;
+        bindings.values[3] = 2.5;
+        expression.evaluateBatch(bindings, fused.data(), Samples, MathMode::Exact);
+
+        ExpressionBindings scalar = bindings;
+        scalar.streams[0] = nullptr;
+        double error = 0.0;
+        for (int j = 0; j < Samples; j++) {
+            scalar.values[0] = xs[j];
+            error = std::max(error, ulpDistance(fused[j], expression.evaluate(scalar)));
+        }
+
+        const bool ok = expression.shape() == test.shape && error <= test.maxUlp;
+        passed = passed && ok;
+        qInfo().noquote() << QString("%1 fused %2 on [%3, %4]: %5 ULP (max %6)%7")
+                                 .arg(QString(ok ? "PASS" : "FAIL"), QString(test.equation))
+                                 .arg(test.from).arg(test.to).arg(error).arg(test.maxUlp)
+                                 .arg(QString(expression.shape() == test.shape ? "" : ", shape not recognized"));
+    }
+
+    ExpressionJit::setEnabled(jitEnabled);
+    return passed;
+}
+
+// Native code against the interpreter on random equations. Both use the same
+// libm calls, so every lane must match bit for bit. The full evaluateBatch
+// with the tier on is checked too, its odd lane count covers the tail the
+// native code leaves to the other paths.
+bool checkJit()
+{
+    if (!ExpressionJit::isSupported()) {
+        qInfo().noquote() << "SKIP JIT, not available on this platform";
+        return true;
+    }
+
+    constexpr int Equations = 500;
+    constexpr int Lanes = 1001;
+    constexpr int MaxDepth = 6;
+
+    const bool jitEnabled = ExpressionJit::isEnabled();
+    ExpressionJit::setEnabled(true);
+
+    QRandomGenerator random(2024);
+    QVector<double> xs(Lanes);
+    QVector<double> native(Lanes);
+    QVector<double> batch(Lanes);
+    QVector<double> expected(Lanes);
+    for (int j = 0; j < Lanes; j++)
+        xs[j] = -5.0 + 10.0 * j / (Lanes - 1);
+
+    int compiled = 0;
+    int mismatches = 0;
+    size_t codeBytes = 0;
+    qint64 generateNs = 0;
+    qint64 nativeNs = 0;
+    qint64 interpreterNs = 0;
+    QElapsedTimer timer;
+
+    for (int k = 0; k < Equations; k++) {
+        const QString equation = randomEquation(random, 1 + random.bounded(MaxDepth));
+        CompiledExpression expression;
+        if (!expression.compile(equation, { "x", "a" }) || !expression.jit())
+            continue;
+        compiled++;
+
+        ExpressionBindings bindings;
+        bindings.streams[0] = xs.constData();
+        bindings.values[1] = 1.37;
+
+        // An empty run generates the code, so the native figure is the kernel alone
+        timer.start();
+        expression.jit()->run(bindings, native.data(), 0, MathMode::Exact);
+        generateNs += timer.nsecsElapsed();
+        codeBytes += expression.jit()->codeSize();
+
+        timer.restart();
+        const int done = expression.jit()->run(bindings, native.data(), Lanes, MathMode::Exact);
+        nativeNs += timer.nsecsElapsed();
+        expression.evaluateBatch(bindings, batch.data(), Lanes, MathMode::Exact);
+
+        // Scalar interpreter per lane as the reference
+        ExpressionBindings scalar = bindings;
+        scalar.streams[0] = nullptr;
+        timer.restart();
+        for (int j = 0; j < Lanes; j++) {
+            scalar.values[0] = xs[j];
+            expected[j] = expression.evaluate(scalar);
+        }
+        interpreterNs += timer.nsecsElapsed();
+
+        for (int j = 0; j < Lanes; j++) {
+            const bool nativeOk = j >= done || sameValue(native[j], expected[j]);
+            if (nativeOk && sameValue(batch[j], expected[j]))
+                continue;
+            mismatches++;
+            qInfo().noquote() << QString("FAIL %1 at x = %2: %3 instead of %4 (%5)")
+                                     .arg(equation).arg(xs[j], 0, 'g', 17)
+                                     .arg(nativeOk ? batch[j] : native[j], 0, 'g', 17).arg(expected[j], 0, 'g', 17)
+                                     .arg(QString(nativeOk ? "evaluateBatch" : "native run"));
+            break;
+        }
+    }
+
+    ExpressionJit::setEnabled(jitEnabled);
+
+    qInfo().noquote() << QString("%1 JIT: %2 random equations, %3 lanes each, %4 mismatching")
+                             .arg(QString(mismatches == 0 ? "PASS" : "FAIL")).arg(compiled).arg(Lanes).arg(mismatches);
+    qInfo().noquote() << QString("Machine code %1 KB generated in %2 ms, native %3 ms, scalar interpreter %4 ms")
+                             .arg(codeBytes / 1024.0, 0, 'f', 1).arg(generateNs / 1e6, 0, 'f', 2)
+                             .arg(nativeNs / 1e6, 0, 'f', 2).arg(interpreterNs / 1e6, 0, 'f', 2);
+    return mismatches == 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    bool passed = checkFastMath();
+    passed = checkSpecialValues() && passed;
+    passed = checkShapes() && passed;
+    passed = checkJit() && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include "EquationModel.h"
+#include <QStringList>
+#include <cmath>
+
+EquationModel::EquationModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int EquationModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_plots.size());
+}
+
+QVariant EquationModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_plots.size())
+        return QVariant();
+
+    const EquationPlot &plot = m_plots[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return plot.name;
+    case Qt::ToolTipRole:
+        return plot.equation;
+    default:
+        return QVariant();
+    }
+}
+
+void EquationModel::append(const EquationPlot &plot)
+{
+    append(QList<EquationPlot>{ plot });
+}
+
+void EquationModel::append(const QList<EquationPlot> &plots)
+{
+    if (plots.isEmpty())
+        return;
+
+    const int first = int(m_plots.size());
+    beginInsertRows(QModelIndex(), first, first + int(plots.size()) - 1);
+    m_plots.reserve(first + plots.size());
+    for (const EquationPlot &plot : plots) {
+        m_rows.insert(plot.name, int(m_plots.size()));
+        m_plots.append(plot);
+    }
+    endInsertRows();
+}
+
+void EquationModel::removeAt(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.remove(m_plots[row].name);
+    m_plots.removeAt(row);
+
+    // Rows after the removed one moved up by one
+    for (int i = row; i < m_plots.size(); i++)
+        m_rows[m_plots[i].name] = i;
+    endRemoveRows();
+}
+
+void EquationModel::rename(int row, const QString &name)
+{
+    EquationPlot &plot = m_plots[row];
+    if (plot.name == name)
+        return;
+
+    m_rows.remove(plot.name);
+    plot.name = name;
+    m_rows.insert(name, row);
+
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, { Qt::DisplayRole });
+}
+
+void EquationModel::equationChanged(int row)
+{
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, { Qt::ToolTipRole });
+}
+
+void EquationModel::clear()
+{
+    beginResetModel();
+    m_plots.clear();
+    m_rows.clear();
+    endResetModel();
+}
+
+void EquationDiagnostics::reset()
+{
+    evaluationError.clear();
+    derivativeError.clear();
+    samples = 0;
+    nan = 0;
+    infinite = 0;
+    outOfRange = 0;
+    culled = 0;
+    cached = false;
+    evaluations = 0;
+    evaluationNs = 0;
+}
+
+void EquationDiagnostics::countSamples(const double *ys, int count, double yMin, double yMax)
+{
+    // Counted without branches, NaN fails both range comparisons
+    int nanCount = 0;
+    int infiniteCount = 0;
+    int outside = 0;
+    for (int i = 0; i < count; i++) {
+        const double y = ys[i];
+        nanCount += std::isnan(y);
+        infiniteCount += std::isinf(y);
+        outside += (y < yMin || y > yMax) && !std::isinf(y);
+    }
+    samples = count;
+    nan = nanCount;
+    infinite = infiniteCount;
+    outOfRange = outside;
+}
+
+QString EquationDiagnostics::summary() const
+{
+    QStringList lines;
+    if (!compileError.isEmpty())
+        lines << "Not compiled, evaluated by JavaScript: " + compileError;
+    if (!evaluationError.isEmpty())
+        lines << "Evaluation failed: " + evaluationError;
+    if (!derivativeError.isEmpty())
+        lines << "Derivatives unavailable: " + derivativeError;
+    if (samples > 0 || evaluations > 0) {
+        QString counters = cached ? QString("%1 samples from the cache").arg(samples)
+                                  : QString("%1 samples, %2 evaluations in %3 ms")
+                                        .arg(samples).arg(evaluations).arg(evaluationNs / 1e6, 0, 'f', 2);
+        if (samples > 0)
+            counters += QString(": %1 NaN, %2 infinite, %3 outside y, %4 merged")
+                            .arg(nan).arg(infinite).arg(outOfRange).arg(culled);
+        lines << counters;
+    }
+    return lines.join('\n');
+}
@@ -0,0 +1,113 @@
+// EquationModel.h
+#ifndef EQUATIONMODEL_H
+#define EQUATIONMODEL_H
+
+#include <QAbstractListModel>
+#include <QColor>
+#include <QHash>
+#include <QList>
+#include <QPointF>
+#include <QString>
+#include <QtCharts/QLineSeries>
+#include "ExpressionEngine.h"
+#include "PointIndex.h"
+#include "SampleCache.h"
+
+// Kind of plot an equation produces
+enum class PlotType {
+    Function,   // y = f(x) line series
+    Heatmap,    // z = f(x, y) colour-mapped image
+    Ode,        // solutions of y' = f(x, y) through initial values
+    IteratedMap,// bifurcation diagram of x <- f(x, r) over r
+    Complex     // w = f(z) over z = x + iy, domain coloured image
+};
+
+// Validation results and runtime counters of an equation. Errors are recorded
+// once, the counters are refilled on every regeneration by one pass over the
+// finished samples, so nothing is logged from inside the sample loops.
+struct EquationDiagnostics {
+    QString compileError;      // why the compiled engine rejected the equation, if it did
+    QString evaluationError;   // first error of the JavaScript fallback in the last regeneration
+    QString derivativeError;   // why requested derivatives weren't drawn in the last regeneration
+    int samples = 0;
+    int nan = 0;
+    int infinite = 0;
+    int outOfRange = 0;        // finite but outside the y range
+    int culled = 0;            // samples merged away by the min/max envelope
+    bool cached = false;       // drawn from the sample cache without evaluating
+    qint64 evaluations = 0;
+    qint64 evaluationNs = 0;
+
+    // Start counting a regeneration, the compile error stays
+    void reset();
+    void countSamples(const double *ys, int count, double yMin, double yMax);
+    QString summary() const;
+};
+
+class EquationPlot {
+public:
+    QString name;
+    QString equation;
+    QColor color;
+    bool visible;
+    double lineWidth;
+    PlotType type;
+    bool showDerivative;
+    bool showSecondDerivative;
+    CompiledExpression compiled;
+    EquationDiagnostics diagnostics;
+    QVector<QPointF> initialValues;   // (x0, y0) of each solution of an ODE
+    SampleCache samples;
+    PointIndex solutionIndex;         // drawn points of an ODE's solutions, for the crosshair
+    quint64 lastVisible;
+    QLineSeries *series;
+    QLineSeries *derivativeSeries;
+    QLineSeries *secondDerivativeSeries;
+
+    EquationPlot() : visible(true), lineWidth(2.0), type(PlotType::Function),
+        showDerivative(false), showSecondDerivative(false), lastVisible(0), series(nullptr),
+        derivativeSeries(nullptr), secondDerivativeSeries(nullptr) {}
+};
+
+// List model owning the session's equations. Names are unique and indexed in
+// a hash, so lookups and duplicate checks don't scan the list, and appending
+// a batch is a single row insertion however many equations it holds. Views
+// show the names; rename() keeps the index in sync, so names must not be
+// assigned directly through the mutable accessors.
+class EquationModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit EquationModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    int size() const { return int(m_plots.size()); }
+    bool isEmpty() const { return m_plots.isEmpty(); }
+    EquationPlot &operator[](int row) { return m_plots[row]; }
+    const EquationPlot &operator[](int row) const { return m_plots[row]; }
+    QList<EquationPlot>::iterator begin() { return m_plots.begin(); }
+    QList<EquationPlot>::iterator end() { return m_plots.end(); }
+    QList<EquationPlot>::const_iterator begin() const { return m_plots.begin(); }
+    QList<EquationPlot>::const_iterator end() const { return m_plots.end(); }
+
+    // Row of the equation with this name, or -1
+    int indexOf(const QString &name) const { return m_rows.value(name, -1); }
+    bool contains(const QString &name) const { return m_rows.contains(name); }
+
+    // Callers check names for uniqueness first
+    void append(const EquationPlot &plot);
+    void append(const QList<EquationPlot> &plots);
+    void removeAt(int row);
+    void rename(int row, const QString &name);
+    void equationChanged(int row);
+    void clear();
+
+private:
+    QList<EquationPlot> m_plots;
+    QHash<QString, int> m_rows;
+};
+
+#endif
@@ -0,0 +1,1194 @@
+#include "ExpressionEngine.h"
+#include "Arena.h"
+#include "ExpressionJit.h"
+#include "FastMath.h"
+#include <QtMath>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+struct FunctionInfo {
+    const char *name;
+    ExprOp op;
+    int arity;
+};
+
+const FunctionInfo kFunctions[] = {
+    { "sin", ExprOp::Sin, 1 },
+    { "cos", ExprOp::Cos, 1 },
+    { "tan", ExprOp::Tan, 1 },
+    { "sqrt", ExprOp::Sqrt, 1 },
+    { "abs", ExprOp::Abs, 1 },
+    { "log", ExprOp::Log, 1 },   // Natural log
+    { "log10", ExprOp::Log10, 1 },
+    { "exp", ExprOp::Exp, 1 },
+    { "pow", ExprOp::Pow, 2 }
+};
+
+bool isUnary(ExprOp op)
+{
+    return op == ExprOp::Neg || op >= ExprOp::Sin;
+}
+
+double applyUnary(ExprOp op, double a)
+{
+    switch (op) {
+    case ExprOp::Neg: return -a;
+    case ExprOp::Sin: return std::sin(a);
+    case ExprOp::Cos: return std::cos(a);
+    case ExprOp::Tan: return std::tan(a);
+    case ExprOp::Sqrt: return std::sqrt(a);
+    case ExprOp::Abs: return std::fabs(a);
+    case ExprOp::Log: return std::log(a);
+    case ExprOp::Log10: return std::log10(a);
+    case ExprOp::Exp: return std::exp(a);
+    default: return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+double applyBinary(ExprOp op, double a, double b)
+{
+    switch (op) {
+    case ExprOp::Add: return a + b;
+    case ExprOp::Sub: return a - b;
+    case ExprOp::Mul: return a * b;
+    case ExprOp::Div: return a / b;
+    case ExprOp::Pow: return std::pow(a, b);
+    default: return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+// Derivative rules for dual numbers, the chain rule for f(u) with known f' and f''
+Jet chain(const Jet &u, double f, double df, double ddf)
+{
+    return { f, df * u.d, ddf * u.d * u.d + df * u.dd };
+}
+
+Jet applyUnaryJet(ExprOp op, const Jet &u)
+{
+    switch (op) {
+    case ExprOp::Neg:
+        return { -u.v, -u.d, -u.dd };
+    case ExprOp::Sin: {
+        const double s = std::sin(u.v), c = std::cos(u.v);
+        return chain(u, s, c, -s);
+    }
+    case ExprOp::Cos: {
+        const double s = std::sin(u.v), c = std::cos(u.v);
+        return chain(u, c, -s, -c);
+    }
+    case ExprOp::Tan: {
+        const double t = std::tan(u.v), sec2 = 1.0 + t * t;
+        return chain(u, t, sec2, 2.0 * t * sec2);
+    }
+    case ExprOp::Sqrt: {
+        const double r = std::sqrt(u.v);
+        return chain(u, r, 0.5 / r, -0.25 / (r * u.v));
+    }
+    case ExprOp::Abs: {
+        const double sign = u.v > 0 ? 1.0 : (u.v < 0 ? -1.0 : 0.0);
+        return chain(u, std::fabs(u.v), sign, 0.0);
+    }
+    case ExprOp::Log:
+        return chain(u, std::log(u.v), 1.0 / u.v, -1.0 / (u.v * u.v));
+    case ExprOp::Log10: {
+        const double k = 1.0 / M_LN10;
+        return chain(u, std::log10(u.v), k / u.v, -k / (u.v * u.v));
+    }
+    case ExprOp::Exp: {
+        const double e = std::exp(u.v);
+        return chain(u, e, e, e);
+    }
+    default:
+        return { std::numeric_limits<double>::quiet_NaN(), 0.0, 0.0 };
+    }
+}
+
+Jet applyBinaryJet(ExprOp op, const Jet &a, const Jet &b)
+{
+    switch (op) {
+    case ExprOp::Add:
+        return { a.v + b.v, a.d + b.d, a.dd + b.dd };
+    case ExprOp::Sub:
+        return { a.v - b.v, a.d - b.d, a.dd - b.dd };
+    case ExprOp::Mul:
+        return { a.v * b.v, a.d * b.v + a.v * b.d, a.dd * b.v + 2.0 * a.d * b.d + a.v * b.dd };
+    case ExprOp::Div: {
+        const double q = a.v / b.v;
+        const double dq = (a.d - q * b.d) / b.v;
+        return { q, dq, (a.dd - 2.0 * dq * b.d - q * b.dd) / b.v };
+    }
+    case ExprOp::Pow: {
+        const double p = std::pow(a.v, b.v);
+        if (b.d == 0.0 && b.dd == 0.0) {
+            // Constant exponent, the power rule also covers negative bases
+            const double n = b.v;
+            const double p1 = n == 0.0 ? 0.0 : n * std::pow(a.v, n - 1.0);
+            const double p2 = (n == 0.0 || n == 1.0) ? 0.0 : n * (n - 1.0) * std::pow(a.v, n - 2.0);
+            return chain(a, p, p1, p2);
+        }
+        // General case through a^b = exp(b * ln a)
+        const double l = std::log(a.v);
+        const double f1 = b.d * l + b.v * a.d / a.v;
+        const double f2 = b.dd * l + 2.0 * b.d * a.d / a.v + b.v * (a.dd / a.v - a.d * a.d / (a.v * a.v));
+        return { p, p * f1, p * (f2 + f1 * f1) };
+    }
+    default:
+        return { std::numeric_limits<double>::quiet_NaN(), 0.0, 0.0 };
+    }
+}
+
+// Complex functions on re + i*im in place, principal branches for log, sqrt and pow
+void complexUnary(ExprOp op, double &re, double &im)
+{
+    const double a = re;
+    const double b = im;
+    switch (op) {
+    case ExprOp::Neg:
+        re = -a;
+        im = -b;
+        break;
+    case ExprOp::Sin:
+        re = std::sin(a) * std::cosh(b);
+        im = std::cos(a) * std::sinh(b);
+        break;
+    case ExprOp::Cos:
+        re = std::cos(a) * std::cosh(b);
+        im = -std::sin(a) * std::sinh(b);
+        break;
+    case ExprOp::Tan: {
+        // Far from the real axis tan tends to +-i, where cosh would overflow
+        if (std::fabs(b) > 20.0) {
+            re = 0.0;
+            im = std::copysign(1.0, b);
+            break;
+        }
+        const double d = std::cos(2.0 * a) + std::cosh(2.0 * b);
+        re = std::sin(2.0 * a) / d;
+        im = std::sinh(2.0 * b) / d;
+        break;
+    }
+    case ExprOp::Sqrt: {
+        // Only the larger part comes from r +- |a|, avoiding the cancellation
+        const double t = std::sqrt(0.5 * (std::hypot(a, b) + std::fabs(a)));
+        if (t == 0.0) {
+            re = 0.0;
+            im = 0.0;
+        } else if (a >= 0.0) {
+            re = t;
+            im = b / (2.0 * t);
+        } else {
+            re = std::fabs(b) / (2.0 * t);
+            im = std::copysign(t, b);
+        }
+        break;
+    }
+    case ExprOp::Abs:
+        re = std::hypot(a, b);
+        im = 0.0;
+        break;
+    case ExprOp::Log:
+        re = std::log(std::hypot(a, b));
+        im = std::atan2(b, a);
+        break;
+    case ExprOp::Log10:
+        re = std::log(std::hypot(a, b)) / M_LN10;
+        im = std::atan2(b, a) / M_LN10;
+        break;
+    case ExprOp::Exp: {
+        const double m = std::exp(a);
+        re = m * std::cos(b);
+        im = m * std::sin(b);
+        break;
+    }
+    default:
+        re = std::numeric_limits<double>::quiet_NaN();
+        im = re;
+        break;
+    }
+}
+
+// a^b as repeated multiplication for small integer exponents, exp(b log a) otherwise
+void complexPow(double &re, double &im, double bRe, double bIm)
+{
+    if (bIm == 0.0 && bRe == std::floor(bRe) && std::fabs(bRe) <= 64.0) {
+        int n = int(std::fabs(bRe));
+        double rRe = 1.0, rIm = 0.0;
+        double pRe = re, pIm = im;
+        while (n > 0) {
+            if (n & 1) {
+                const double t = rRe * pRe - rIm * pIm;
+                rIm = rRe * pIm + rIm * pRe;
+                rRe = t;
+            }
+            const double t = pRe * pRe - pIm * pIm;
+            pIm = 2.0 * pRe * pIm;
+            pRe = t;
+            n >>= 1;
+        }
+        if (bRe < 0.0) {
+            const double d = rRe * rRe + rIm * rIm;
+            rRe = rRe / d;
+            rIm = -rIm / d;
+        }
+        re = rRe;
+        im = rIm;
+        return;
+    }
+    if (re == 0.0 && im == 0.0) {
+        re = bRe > 0.0 ? 0.0 : std::numeric_limits<double>::quiet_NaN();
+        im = re;
+        return;
+    }
+    double lRe = re, lIm = im;
+    complexUnary(ExprOp::Log, lRe, lIm);
+    re = bRe * lRe - bIm * lIm;
+    im = bRe * lIm + bIm * lRe;
+    complexUnary(ExprOp::Exp, re, im);
+}
+
+// Recursive descent parser producing a constant-folded expression tree.
+// Grammar: expr := term (('+'|'-') term)*
+//          term := unary (('*'|'/') unary)*
+//          unary := ('-'|'+') unary | power
+//          power := primary (('^'|'**') unary)?
+//          primary := number | name | name '(' args ')' | '(' expr ')'
+class Parser {
+public:
+    Parser(const QString &source, const QStringList &variables, std::vector<ExprNode> &nodes)
+        : m_src(source), m_variables(variables), m_nodes(nodes) {}
+
+    int parse()
+    {
+        int root = parseExpr();
+        skipSpaces();
+        if (root >= 0 && m_pos < m_src.size())
+            return fail(QString("Unexpected '%1' at position %2").arg(m_src.at(m_pos)).arg(m_pos + 1));
+        return root;
+    }
+
+    QString error() const { return m_error; }
+
+private:
+    int fail(const QString &message)
+    {
+        if (m_error.isEmpty())
+            m_error = message;
+        return -1;
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_src.size() && m_src.at(m_pos).isSpace())
+            m_pos++;
+    }
+
+    bool accept(const char *token)
+    {
+        skipSpaces();
+        const QLatin1String text(token);
+        if (QStringView(m_src).mid(m_pos).startsWith(text)) {
+            m_pos += text.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(QChar c)
+    {
+        skipSpaces();
+        return m_pos < m_src.size() && m_src.at(m_pos) == c;
+    }
+
+    int makeConst(double value)
+    {
+        ExprNode node;
+        node.op = ExprOp::Const;
+        node.value = value;
+        m_nodes.push_back(node);
+        return int(m_nodes.size()) - 1;
+    }
+
+    int makeNode(ExprOp op, int lhs, int rhs = -1)
+    {
+        if (lhs < 0 || (!isUnary(op) && rhs < 0))
+            return -1;
+
+        // Fold operations on constants at compile time. Results outside the
+        // reals, like sqrt(-1), are kept for complex evaluation to compute.
+        const ExprNode &a = m_nodes[lhs];
+        if (isUnary(op) && a.op == ExprOp::Const && std::isfinite(applyUnary(op, a.value)))
+            return makeConst(applyUnary(op, a.value));
+        if (!isUnary(op) && a.op == ExprOp::Const && m_nodes[rhs].op == ExprOp::Const &&
+            std::isfinite(applyBinary(op, a.value, m_nodes[rhs].value)))
+            return makeConst(applyBinary(op, a.value, m_nodes[rhs].value));
+
+        ExprNode node;
+        node.op = op;
+        node.lhs = lhs;
+        node.rhs = rhs;
+        m_nodes.push_back(node);
+        return int(m_nodes.size()) - 1;
+    }
+
+    int parseExpr()
+    {
+        int lhs = parseTerm();
+        while (lhs >= 0) {
+            if (accept("+"))
+                lhs = makeNode(ExprOp::Add, lhs, parseTerm());
+            else if (accept("-"))
+                lhs = makeNode(ExprOp::Sub, lhs, parseTerm());
+            else
+                break;
+        }
+        return lhs;
+    }
+
+    int parseTerm()
+    {
+        int lhs = parseUnary();
+        while (lhs >= 0) {
+            if (accept("*"))
+                lhs = makeNode(ExprOp::Mul, lhs, parseUnary());
+            else if (accept("/"))
+                lhs = makeNode(ExprOp::Div, lhs, parseUnary());
+            else
+                break;
+        }
+        return lhs;
+    }
+
+    int parseUnary()
+    {
+        if (accept("-"))
+            return makeNode(ExprOp::Neg, parseUnary());
+        if (accept("+"))
+            return parseUnary();
+        return parsePower();
+    }
+
+    int parsePower()
+    {
+        int base = parsePrimary();
+        if (base >= 0 && (accept("^") || accept("**")))
+            return makeNode(ExprOp::Pow, base, parseUnary());
+        return base;
+    }
+
+    int parseNumber()
+    {
+        const int start = m_pos;
+        while (m_pos < m_src.size() && (m_src.at(m_pos).isDigit() || m_src.at(m_pos) == '.'))
+            m_pos++;
+        // Optional exponent, e.g. 1.5e-3
+        if (m_pos < m_src.size() && (m_src.at(m_pos) == 'e' || m_src.at(m_pos) == 'E')) {
+            int end = m_pos + 1;
+            if (end < m_src.size() && (m_src.at(end) == '+' || m_src.at(end) == '-'))
+                end++;
+            if (end < m_src.size() && m_src.at(end).isDigit()) {
+                m_pos = end;
+                while (m_pos < m_src.size() && m_src.at(m_pos).isDigit())
+                    m_pos++;
+            }
+        }
+
+        bool ok = false;
+        const double value = m_src.mid(start, m_pos - start).toDouble(&ok);
+        if (!ok)
+            return fail(QString("Invalid number at position %1").arg(start + 1));
+        return makeConst(value);
+    }
+
+    int parsePrimary()
+    {
+        skipSpaces();
+        if (m_pos >= m_src.size())
+            return fail("Unexpected end of expression");
+
+        const QChar c = m_src.at(m_pos);
+        if (c.isDigit() || c == '.')
+            return parseNumber();
+
+        if (accept("(")) {
+            int inner = parseExpr();
+            if (inner >= 0 && !accept(")"))
+                return fail("Missing ')'");
+            return inner;
+        }
+
+        if (!c.isLetter() && c != '_')
+            return fail(QString("Unexpected '%1' at position %2").arg(c).arg(m_pos + 1));
+
+        const int start = m_pos;
+        while (m_pos < m_src.size() && (m_src.at(m_pos).isLetterOrNumber() || m_src.at(m_pos) == '_' || m_src.at(m_pos) == '.'))
+            m_pos++;
+        QString name = m_src.mid(start, m_pos - start);
+
+        // Accept the Math.* spellings the JavaScript evaluator understands
+        if (name.startsWith("Math."))
+            name = name.mid(5).toLower();
+
+        if (peek('(')) {
+            for (const FunctionInfo &fn : kFunctions) {
+                if (name != QLatin1String(fn.name))
+                    continue;
+                accept("(");
+                int lhs = parseExpr();
+                int rhs = -1;
+                if (fn.arity == 2 && lhs >= 0) {
+                    if (!accept(","))
+                        return fail(QString("%1() expects two arguments").arg(name));
+                    rhs = parseExpr();
+                }
+                if (lhs >= 0 && !accept(")"))
+                    return fail(QString("Missing ')' after %1(").arg(name));
+                return makeNode(fn.op, lhs, rhs);
+            }
+            return fail(QString("Unknown function '%1'").arg(name));
+        }
+
+        const int slot = m_variables.indexOf(name);
+        if (slot >= 0) {
+            ExprNode node;
+            node.op = ExprOp::Var;
+            node.slot = slot;
+            m_nodes.push_back(node);
+            return int(m_nodes.size()) - 1;
+        }
+        if (name == "pi")
+            return makeConst(M_PI);
+        if (name == "e")
+            return makeConst(M_E);
+
+        return fail(QString("Unknown variable '%1'").arg(name));
+    }
+
+    const QString &m_src;
+    const QStringList &m_variables;
+    std::vector<ExprNode> &m_nodes;
+    int m_pos = 0;
+    QString m_error;
+};
+
+// Emit postfix code for the subtree at index, returning the stack depth it needs
+int emit(const std::vector<ExprNode> &nodes, int index, std::vector<ExprInstr> &code)
+{
+    const ExprNode &node = nodes[index];
+    int depth = 1;
+    if (node.lhs >= 0)
+        depth = emit(nodes, node.lhs, code);
+    if (node.rhs >= 0)
+        depth = std::max(depth, 1 + emit(nodes, node.rhs, code));
+    code.push_back({ node.op, node.slot, node.value });
+    return depth;
+}
+
+// Shape recognition for the fused kernels. x is slot 0, the sampled variable
+// of every plot; all other leaves must be constants or scalar parameters.
+
+bool isX(const ExprNode &node)
+{
+    return node.op == ExprOp::Var && node.slot == 0;
+}
+
+// A constant or a parameter, possibly negated
+bool matchScalar(const std::vector<ExprNode> &nodes, int index, double sign, ExprOperand &operand)
+{
+    const ExprNode &node = nodes[index];
+    if (node.op == ExprOp::Neg)
+        return matchScalar(nodes, node.lhs, -sign, operand);
+    if (node.op == ExprOp::Const) {
+        operand = { -1, sign * node.value };
+        return true;
+    }
+    if (node.op == ExprOp::Var && node.slot != 0) {
+        operand = { node.slot, sign };
+        return true;
+    }
+    return false;
+}
+
+// k for x or x^k with a constant integer 2 <= k <= MaxDegree, 0 otherwise
+int matchPowerOfX(const std::vector<ExprNode> &nodes, int index)
+{
+    const ExprNode &node = nodes[index];
+    if (isX(node))
+        return 1;
+    if (node.op != ExprOp::Pow || !isX(nodes[node.lhs]) || nodes[node.rhs].op != ExprOp::Const)
+        return 0;
+    const double k = nodes[node.rhs].value;
+    return k >= 2.0 && k <= CompiledExpression::MaxDegree && k == std::floor(k) ? int(k) : 0;
+}
+
+// Sums and differences of monomials c * x^k, each power at most once. terms
+// is indexed by k, present has bit k set for every power seen.
+bool matchPolynomial(const std::vector<ExprNode> &nodes, int index, double sign,
+                     std::vector<ExprOperand> &terms, unsigned &present)
+{
+    const ExprNode &node = nodes[index];
+    if (node.op == ExprOp::Add || node.op == ExprOp::Sub) {
+        const double rhsSign = node.op == ExprOp::Sub ? -sign : sign;
+        return matchPolynomial(nodes, node.lhs, sign, terms, present) &&
+               matchPolynomial(nodes, node.rhs, rhsSign, terms, present);
+    }
+    if (node.op == ExprOp::Neg)
+        return matchPolynomial(nodes, node.lhs, -sign, terms, present);
+
+    ExprOperand coefficient{ -1, sign };
+    int degree = 0;
+    if (!matchScalar(nodes, index, sign, coefficient)) {
+        degree = matchPowerOfX(nodes, index);
+        if (degree == 0 && node.op == ExprOp::Mul) {
+            if (matchScalar(nodes, node.lhs, sign, coefficient))
+                degree = matchPowerOfX(nodes, node.rhs);
+            else if (matchScalar(nodes, node.rhs, sign, coefficient))
+                degree = matchPowerOfX(nodes, node.lhs);
+        }
+        if (degree == 0)
+            return false;
+    }
+
+    if (present & (1u << degree))
+        return false;
+    present |= 1u << degree;
+    terms[degree] = coefficient;
+    return true;
+}
+
+// x, b*x or x*b
+bool matchLinear(const std::vector<ExprNode> &nodes, int index, ExprOperand &b)
+{
+    const ExprNode &node = nodes[index];
+    b = { -1, 1.0 };
+    if (isX(node))
+        return true;
+    if (node.op != ExprOp::Mul)
+        return false;
+    if (isX(nodes[node.rhs]))
+        return matchScalar(nodes, node.lhs, 1.0, b);
+    if (isX(nodes[node.lhs]))
+        return matchScalar(nodes, node.rhs, 1.0, b);
+    return false;
+}
+
+// A linear term plus or minus a scalar c, or the linear term alone
+bool matchAffine(const std::vector<ExprNode> &nodes, int index, ExprOperand &b, ExprOperand &c)
+{
+    const ExprNode &node = nodes[index];
+    c = { -1, 0.0 };
+    if (node.op == ExprOp::Add || node.op == ExprOp::Sub) {
+        if (matchScalar(nodes, node.rhs, node.op == ExprOp::Sub ? -1.0 : 1.0, c))
+            return matchLinear(nodes, node.lhs, b);
+        if (node.op == ExprOp::Add && matchScalar(nodes, node.lhs, 1.0, c))
+            return matchLinear(nodes, node.rhs, b);
+        return false;
+    }
+    return matchLinear(nodes, index, b);
+}
+
+// a * f(b*x + c) for f = sin or cos, a scalar on either side or left out
+bool matchWave(const std::vector<ExprNode> &nodes, int index, ExprOp &function, std::vector<ExprOperand> &operands)
+{
+    const ExprNode *node = &nodes[index];
+    ExprOperand a{ -1, 1.0 };
+    double sign = 1.0;
+    if (node->op == ExprOp::Neg) {
+        sign = -1.0;
+        a.scale = -1.0;
+        node = &nodes[node->lhs];
+    }
+    if (node->op == ExprOp::Mul) {
+        if (matchScalar(nodes, node->lhs, sign, a))
+            node = &nodes[node->rhs];
+        else if (matchScalar(nodes, node->rhs, sign, a))
+            node = &nodes[node->lhs];
+        else
+            return false;
+    }
+    if (node->op != ExprOp::Sin && node->op != ExprOp::Cos)
+        return false;
+
+    ExprOperand b, c;
+    if (!matchAffine(nodes, node->lhs, b, c))
+        return false;
+    function = node->op;
+    operands = { a, b, c };
+    return true;
+}
+
+ExprShape matchShape(const std::vector<ExprNode> &nodes, int root, ExprOp &function, int &power,
+                     std::vector<ExprOperand> &operands)
+{
+    power = matchPowerOfX(nodes, root);
+    if (power >= 2)
+        return ExprShape::Power;
+    if (matchWave(nodes, root, function, operands))
+        return ExprShape::Wave;
+
+    // A polynomial needs at least one power of x, bit 0 alone is a constant
+    std::vector<ExprOperand> terms(CompiledExpression::MaxDegree + 1, ExprOperand{ -1, 0.0 });
+    unsigned present = 0;
+    if (matchPolynomial(nodes, root, 1.0, terms, present) && present > 1) {
+        int degree = CompiledExpression::MaxDegree;
+        while (!(present & (1u << degree)))
+            degree--;
+        terms.resize(degree + 1);
+        operands = terms;
+        return ExprShape::Polynomial;
+    }
+    return ExprShape::None;
+}
+
+// Fused kernels, one loop per shape over all lanes with no opcode dispatch.
+// The degree or power is a template parameter, so the inner loops unroll.
+
+template <int Degree>
+void hornerKernel(const double *x, const double *c, double *out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        double p = c[Degree];
+        for (int k = Degree - 1; k >= 0; k--)
+            p = p * x[i] + c[k];
+        out[i] = p;
+    }
+}
+
+// x^N by repeated squaring
+template <int N>
+inline double powerOf(double x)
+{
+    if constexpr (N == 0)
+        return 1.0;
+    else if constexpr (N % 2 == 0) {
+        const double half = powerOf<N / 2>(x);
+        return half * half;
+    } else {
+        return powerOf<N - 1>(x) * x;
+    }
+}
+
+template <int N>
+void powerKernel(const double *x, double *out, int n)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = powerOf<N>(x[i]);
+}
+
+template <ExprOp Function>
+void waveKernel(const double *x, double a, double b, double c, double *out, int n, MathMode mode)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = b * x[i] + c;
+    if (mode == MathMode::Fast) {
+        if constexpr (Function == ExprOp::Sin)
+            FastMath::sin(out, n);
+        else
+            FastMath::cos(out, n);
+    } else {
+        for (int i = 0; i < n; i++)
+            out[i] = Function == ExprOp::Sin ? std::sin(out[i]) : std::cos(out[i]);
+    }
+    for (int i = 0; i < n; i++)
+        out[i] *= a;
+}
+
+using HornerKernel = void (*)(const double *x, const double *c, double *out, int n);
+using PowerKernel = void (*)(const double *x, double *out, int n);
+
+template <int... Degrees>
+constexpr std::array<HornerKernel, sizeof...(Degrees)> makeHornerKernels(std::integer_sequence<int, Degrees...>)
+{
+    return { { &hornerKernel<Degrees>... } };
+}
+
+template <int... Powers>
+constexpr std::array<PowerKernel, sizeof...(Powers)> makePowerKernels(std::integer_sequence<int, Powers...>)
+{
+    return { { &powerKernel<Powers>... } };
+}
+
+// Dispatch tables indexed by degree and power, built at compile time
+constexpr auto kHornerKernels = makeHornerKernels(std::make_integer_sequence<int, CompiledExpression::MaxDegree + 1>());
+constexpr auto kPowerKernels = makePowerKernels(std::make_integer_sequence<int, CompiledExpression::MaxDegree + 1>());
+
+} // namespace
+
+bool CompiledExpression::compile(const QString &source, const QStringList &variables, QString *error)
+{
+    m_source = source;
+    m_variables = variables;
+    m_nodes.clear();
+    m_code.clear();
+    m_maxDepth = 0;
+    m_shape = ExprShape::None;
+    m_shapeOperands.clear();
+    m_jit.reset();
+
+    QString message;
+    if (variables.size() > ExpressionBindings::MaxSlots) {
+        message = "Too many variables";
+    } else {
+        Parser parser(source, variables, m_nodes);
+        const int root = parser.parse();
+        if (root < 0) {
+            message = parser.error();
+        } else {
+            m_maxDepth = emit(m_nodes, root, m_code);
+            if (m_maxDepth > MaxStackDepth)
+                message = "Expression is nested too deeply";
+            else
+                m_shape = matchShape(m_nodes, root, m_shapeFunction, m_shapePower, m_shapeOperands);
+        }
+    }
+
+    if (!message.isEmpty()) {
+        m_code.clear();
+        m_shape = ExprShape::None;
+        if (error)
+            *error = message;
+        return false;
+    }
+
+    if (ExpressionJit::isSupported())
+        m_jit = std::make_shared<const ExpressionJit>(m_code, m_maxDepth);
+    return true;
+}
+
+QStringList CompiledExpression::freeNames(const QString &source, const QStringList &known)
+{
+    QStringList names;
+    int pos = 0;
+    while (pos < source.size()) {
+        const QChar c = source.at(pos);
+
+        // Skip numbers with their exponent, so 1e5 isn't read as a name
+        if (c.isDigit() || c == '.') {
+            while (pos < source.size() && (source.at(pos).isDigit() || source.at(pos) == '.'))
+                pos++;
+            if (pos < source.size() && (source.at(pos) == 'e' || source.at(pos) == 'E')) {
+                int end = pos + 1;
+                if (end < source.size() && (source.at(end) == '+' || source.at(end) == '-'))
+                    end++;
+                if (end < source.size() && source.at(end).isDigit()) {
+                    pos = end;
+                    while (pos < source.size() && source.at(pos).isDigit())
+                        pos++;
+                }
+            }
+            continue;
+        }
+
+        if (!c.isLetter() && c != '_') {
+            pos++;
+            continue;
+        }
+
+        const int start = pos;
+        while (pos < source.size() && (source.at(pos).isLetterOrNumber() || source.at(pos) == '_' || source.at(pos) == '.'))
+            pos++;
+        const QString name = source.mid(start, pos - start);
+
+        // Function calls, Math.* spellings and constants aren't parameters
+        int next = pos;
+        while (next < source.size() && source.at(next).isSpace())
+            next++;
+        const bool call = next < source.size() && source.at(next) == '(';
+        if (call || name.startsWith("Math.") || name == "pi" || name == "e")
+            continue;
+
+        if (!known.contains(name) && !names.contains(name))
+            names.append(name);
+    }
+    return names;
+}
+
+bool CompiledExpression::usesSlot(int slot) const
+{
+    return std::any_of(m_code.begin(), m_code.end(), [slot](const ExprInstr &ins) {
+        return ins.op == ExprOp::Var && ins.slot == slot;
+    });
+}
+
+double CompiledExpression::evaluate(const ExpressionBindings &bindings) const
+{
+    if (m_code.empty())
+        return std::numeric_limits<double>::quiet_NaN();
+
+    double stack[MaxStackDepth];
+    int sp = -1;
+    for (const ExprInstr &ins : m_code) {
+        switch (ins.op) {
+        case ExprOp::Const:
+            stack[++sp] = ins.value;
+            break;
+        case ExprOp::Var:
+            stack[++sp] = bindings.streams[ins.slot] ? bindings.streams[ins.slot][0] : bindings.values[ins.slot];
+            break;
+        case ExprOp::Add:
+        case ExprOp::Sub:
+        case ExprOp::Mul:
+        case ExprOp::Div:
+        case ExprOp::Pow:
+            stack[sp - 1] = applyBinary(ins.op, stack[sp - 1], stack[sp]);
+            sp--;
+            break;
+        default:
+            stack[sp] = applyUnary(ins.op, stack[sp]);
+            break;
+        }
+    }
+    return stack[0];
+}
+
+void CompiledExpression::evaluateBatch(const ExpressionBindings &bindings, double *out, int count,
+                                       MathMode mode) const
+{
+    // Native code pairs lanes, an odd last lane goes through the paths below
+    if (m_jit && ExpressionJit::isEnabled()) {
+        const int done = m_jit->run(bindings, out, count, mode);
+        if (done == count)
+            return;
+        if (done > 0) {
+            ExpressionBindings rest = bindings;
+            for (const double *&stream : rest.streams) {
+                if (stream)
+                    stream += done;
+            }
+            evaluateBatch(rest, out + done, count - done, mode);
+            return;
+        }
+    }
+
+    if (m_shape != ExprShape::None && evaluateShape(bindings, out, count, mode))
+        return;
+
+    const bool fast = mode == MathMode::Fast;
+
+    if (m_code.empty()) {
+        std::fill_n(out, count, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+
+    // One block of lanes per stack entry, each opcode runs over the whole block.
+    // The stack lives in the thread's arena, so steady-state calls don't allocate.
+    Arena &arena = Arena::threadLocal();
+    Arena::Scope scope(arena);
+    double *stack = arena.allocateArray<double>(size_t(m_maxDepth) * BlockSize);
+
+    for (int offset = 0; offset < count; offset += BlockSize) {
+        const int n = std::min(BlockSize, count - offset);
+        int sp = -1;
+
+        for (const ExprInstr &ins : m_code) {
+            double *top = stack + size_t(std::max(sp, 0)) * BlockSize;
+            double *below = stack + size_t(std::max(sp - 1, 0)) * BlockSize;
+
+            switch (ins.op) {
+            case ExprOp::Const:
+                std::fill_n(stack + size_t(++sp) * BlockSize, n, ins.value);
+                break;
+            case ExprOp::Var: {
+                double *dst = stack + size_t(++sp) * BlockSize;
+                if (const double *src = bindings.streams[ins.slot])
+                    std::copy_n(src + offset, n, dst);
+                else
+                    std::fill_n(dst, n, bindings.values[ins.slot]);
+                break;
+            }
+            case ExprOp::Add:
+                for (int i = 0; i < n; i++) below[i] += top[i];
+                sp--;
+                break;
+            case ExprOp::Sub:
+                for (int i = 0; i < n; i++) below[i] -= top[i];
+                sp--;
+                break;
+            case ExprOp::Mul:
+                for (int i = 0; i < n; i++) below[i] *= top[i];
+                sp--;
+                break;
+            case ExprOp::Div:
+                for (int i = 0; i < n; i++) below[i] /= top[i];
+                sp--;
+                break;
+            case ExprOp::Pow:
+                for (int i = 0; i < n; i++) below[i] = std::pow(below[i], top[i]);
+                sp--;
+                break;
+            case ExprOp::Neg:
+                for (int i = 0; i < n; i++) top[i] = -top[i];
+                break;
+            case ExprOp::Sin:
+                if (fast)
+                    FastMath::sin(top, n);
+                else
+                    for (int i = 0; i < n; i++) top[i] = std::sin(top[i]);
+                break;
+            case ExprOp::Cos:
+                if (fast)
+                    FastMath::cos(top, n);
+                else
+                    for (int i = 0; i < n; i++) top[i] = std::cos(top[i]);
+                break;
+            case ExprOp::Tan:
+                if (fast)
+                    FastMath::tan(top, n);
+                else
+                    for (int i = 0; i < n; i++) top[i] = std::tan(top[i]);
+                break;
+            case ExprOp::Sqrt:
+                for (int i = 0; i < n; i++) top[i] = std::sqrt(top[i]);
+                break;
+            case ExprOp::Abs:
+                for (int i = 0; i < n; i++) top[i] = std::fabs(top[i]);
+                break;
+            case ExprOp::Log:
+                if (fast)
+                    FastMath::log(top, n);
+                else
+                    for (int i = 0; i < n; i++) top[i] = std::log(top[i]);
+                break;
+            case ExprOp::Log10:
+                if (fast)
+                    FastMath::log10(top, n);
+                else
+                    for (int i = 0; i < n; i++) top[i] = std::log10(top[i]);
+                break;
+            case ExprOp::Exp:
+                if (fast)
+                    FastMath::exp(top, n);
+                else
+                    for (int i = 0; i < n; i++) top[i] = std::exp(top[i]);
+                break;
+            }
+        }
+
+        std::copy_n(stack, n, out + offset);
+    }
+}
+
+bool CompiledExpression::evaluateShape(const ExpressionBindings &bindings, double *out, int count,
+                                       MathMode mode) const
+{
+    // The kernels stream x from slot 0 and need every operand as a scalar
+    const double *x = bindings.streams[0];
+    if (!x)
+        return false;
+    double operands[MaxDegree + 1];
+    for (size_t k = 0; k < m_shapeOperands.size(); k++) {
+        const ExprOperand &operand = m_shapeOperands[k];
+        if (operand.slot >= 0 && bindings.streams[operand.slot])
+            return false;
+        operands[k] = operand.slot >= 0 ? operand.scale * bindings.values[operand.slot] : operand.scale;
+    }
+
+    switch (m_shape) {
+    case ExprShape::Polynomial:
+        kHornerKernels[m_shapeOperands.size() - 1](x, operands, out, count);
+        return true;
+    case ExprShape::Power:
+        kPowerKernels[m_shapePower](x, out, count);
+        return true;
+    case ExprShape::Wave:
+        if (m_shapeFunction == ExprOp::Sin)
+            waveKernel<ExprOp::Sin>(x, operands[0], operands[1], operands[2], out, count, mode);
+        else
+            waveKernel<ExprOp::Cos>(x, operands[0], operands[1], operands[2], out, count, mode);
+        return true;
+    default:
+        return false;
+    }
+}
+
+Jet CompiledExpression::evaluateJet(const ExpressionBindings &bindings, int wrt) const
+{
+    if (m_code.empty())
+        return { std::numeric_limits<double>::quiet_NaN(), 0.0, 0.0 };
+
+    Jet stack[MaxStackDepth];
+    int sp = -1;
+    for (const ExprInstr &ins : m_code) {
+        switch (ins.op) {
+        case ExprOp::Const:
+            stack[++sp] = { ins.value, 0.0, 0.0 };
+            break;
+        case ExprOp::Var: {
+            const double v = bindings.streams[ins.slot] ? bindings.streams[ins.slot][0] : bindings.values[ins.slot];
+            stack[++sp] = { v, ins.slot == wrt ? 1.0 : 0.0, 0.0 };
+            break;
+        }
+        case ExprOp::Add:
+        case ExprOp::Sub:
+        case ExprOp::Mul:
+        case ExprOp::Div:
+        case ExprOp::Pow:
+            stack[sp - 1] = applyBinaryJet(ins.op, stack[sp - 1], stack[sp]);
+            sp--;
+            break;
+        default:
+            stack[sp] = applyUnaryJet(ins.op, stack[sp]);
+            break;
+        }
+    }
+    return stack[0];
+}
+
+void CompiledExpression::evaluateBatchJet(const ExpressionBindings &bindings, int wrt,
+                                          double *value, double *d1, double *d2, int count) const
+{
+    if (m_code.empty()) {
+        std::fill_n(value, count, std::numeric_limits<double>::quiet_NaN());
+        if (d1)
+            std::fill_n(d1, count, std::numeric_limits<double>::quiet_NaN());
+        if (d2)
+            std::fill_n(d2, count, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+
+    Arena &arena = Arena::threadLocal();
+    Arena::Scope scope(arena);
+    Jet *stack = arena.allocateArray<Jet>(size_t(m_maxDepth) * BlockSize);
+
+    for (int offset = 0; offset < count; offset += BlockSize) {
+        const int n = std::min(BlockSize, count - offset);
+        int sp = -1;
+
+        for (const ExprInstr &ins : m_code) {
+            Jet *top = stack + size_t(std::max(sp, 0)) * BlockSize;
+            Jet *below = stack + size_t(std::max(sp - 1, 0)) * BlockSize;
+
+            switch (ins.op) {
+            case ExprOp::Const:
+                std::fill_n(stack + size_t(++sp) * BlockSize, n, Jet{ ins.value, 0.0, 0.0 });
+                break;
+            case ExprOp::Var: {
+                Jet *dst = stack + size_t(++sp) * BlockSize;
+                const double seed = ins.slot == wrt ? 1.0 : 0.0;
+                const double *src = bindings.streams[ins.slot];
+                for (int i = 0; i < n; i++)
+                    dst[i] = { src ? src[offset + i] : bindings.values[ins.slot], seed, 0.0 };
+                break;
+            }
+            case ExprOp::Add:
+            case ExprOp::Sub:
+            case ExprOp::Mul:
+            case ExprOp::Div:
+            case ExprOp::Pow:
+                for (int i = 0; i < n; i++)
+                    below[i] = applyBinaryJet(ins.op, below[i], top[i]);
+                sp--;
+                break;
+            default:
+                for (int i = 0; i < n; i++)
+                    top[i] = applyUnaryJet(ins.op, top[i]);
+                break;
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            value[offset + i] = stack[i].v;
+            if (d1)
+                d1[offset + i] = stack[i].d;
+            if (d2)
+                d2[offset + i] = stack[i].dd;
+        }
+    }
+}
+
+void CompiledExpression::evaluateBatchComplex(const ExpressionBindings &re, const ExpressionBindings &im,
+                                              double *outRe, double *outIm, int count) const
+{
+    if (m_code.empty()) {
+        std::fill_n(outRe, count, std::numeric_limits<double>::quiet_NaN());
+        std::fill_n(outIm, count, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+
+    // Real and imaginary parts in separate stacks, so the arithmetic loops vectorize
+    Arena &arena = Arena::threadLocal();
+    Arena::Scope scope(arena);
+    double *stackRe = arena.allocateArray<double>(size_t(m_maxDepth) * BlockSize);
+    double *stackIm = arena.allocateArray<double>(size_t(m_maxDepth) * BlockSize);
+
+    for (int offset = 0; offset < count; offset += BlockSize) {
+        const int n = std::min(BlockSize, count - offset);
+        int sp = -1;
+
+        for (const ExprInstr &ins : m_code) {
+            double *aRe = stackRe + size_t(std::max(sp - 1, 0)) * BlockSize;
+            double *aIm = stackIm + size_t(std::max(sp - 1, 0)) * BlockSize;
+            double *bRe = stackRe + size_t(std::max(sp, 0)) * BlockSize;
+            double *bIm = stackIm + size_t(std::max(sp, 0)) * BlockSize;
+
+            switch (ins.op) {
+            case ExprOp::Const:
+                ++sp;
+                std::fill_n(stackRe + size_t(sp) * BlockSize, n, ins.value);
+                std::fill_n(stackIm + size_t(sp) * BlockSize, n, 0.0);
+                break;
+            case ExprOp::Var: {
+                ++sp;
+                double *dstRe = stackRe + size_t(sp) * BlockSize;
+                double *dstIm = stackIm + size_t(sp) * BlockSize;
+                if (re.streams[ins.slot])
+                    std::copy_n(re.streams[ins.slot] + offset, n, dstRe);
+                else
+                    std::fill_n(dstRe, n, re.values[ins.slot]);
+                if (im.streams[ins.slot])
+                    std::copy_n(im.streams[ins.slot] + offset, n, dstIm);
+                else
+                    std::fill_n(dstIm, n, im.values[ins.slot]);
+                break;
+            }
+            case ExprOp::Add:
+                for (int i = 0; i < n; i++) {
+                    aRe[i] += bRe[i];
+                    aIm[i] += bIm[i];
+                }
+                sp--;
+                break;
+            case ExprOp::Sub:
+                for (int i = 0; i < n; i++) {
+                    aRe[i] -= bRe[i];
+                    aIm[i] -= bIm[i];
+                }
+                sp--;
+                break;
+            case ExprOp::Mul:
+                for (int i = 0; i < n; i++) {
+                    const double r = aRe[i] * bRe[i] - aIm[i] * bIm[i];
+                    aIm[i] = aRe[i] * bIm[i] + aIm[i] * bRe[i];
+                    aRe[i] = r;
+                }
+                sp--;
+                break;
+            case ExprOp::Div:
+                for (int i = 0; i < n; i++) {
+                    const double d = bRe[i] * bRe[i] + bIm[i] * bIm[i];
+                    const double r = (aRe[i] * bRe[i] + aIm[i] * bIm[i]) / d;
+                    aIm[i] = (aIm[i] * bRe[i] - aRe[i] * bIm[i]) / d;
+                    aRe[i] = r;
+                }
+                sp--;
+                break;
+            case ExprOp::Pow:
+                for (int i = 0; i < n; i++)
+                    complexPow(aRe[i], aIm[i], bRe[i], bIm[i]);
+                sp--;
+                break;
+            default:
+                for (int i = 0; i < n; i++)
+                    complexUnary(ins.op, bRe[i], bIm[i]);
+                break;
+            }
+        }
+
+        std::copy_n(stackRe, n, outRe + offset);
+        std::copy_n(stackIm, n, outIm + offset);
+    }
+}
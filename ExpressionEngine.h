@@ -0,0 +1,156 @@
+// ExpressionEngine.h
+#ifndef EXPRESSIONENGINE_H
+#define EXPRESSIONENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+class ExpressionJit;
+
+// Operations understood by the compiled expression engine
+enum class ExprOp : unsigned char {
+    Const,
+    Var,
+    Neg,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Pow,
+    Sin,
+    Cos,
+    Tan,
+    Sqrt,
+    Abs,
+    Log,
+    Log10,
+    Exp
+};
+
+// Parsed expression tree node, children are indices into the node list
+struct ExprNode {
+    ExprOp op = ExprOp::Const;
+    int lhs = -1;
+    int rhs = -1;
+    int slot = -1;
+    double value = 0.0;
+};
+
+// One postfix instruction of the compiled program
+struct ExprInstr {
+    ExprOp op;
+    int slot;
+    double value;
+};
+
+// Common expression shapes in slot 0 that evaluateBatch runs as one fused
+// loop instead of interpreting the program opcode by opcode
+enum class ExprShape : unsigned char {
+    None,
+    Polynomial,   // sum of c * x^k terms with k <= MaxDegree, includes a*x + b
+    Power,        // x^n for integer 2 <= n <= MaxDegree
+    Wave          // a * sin(b*x + c) or a * cos(b*x + c)
+};
+
+// Scalar operand of a fused kernel: scale times the value of slot, or scale
+// alone when slot is -1. Parameters stay slots so they can change freely.
+struct ExprOperand {
+    int slot = -1;
+    double scale = 1.0;
+};
+
+// How evaluateBatch computes sin, cos, tan, exp, log and log10. Fast uses the
+// FastMath polynomials, which are good to a few ULP and meant for previews.
+enum class MathMode {
+    Exact,
+    Fast
+};
+
+// Values for the variable slots of a compiled expression. A slot either
+// streams one value per lane from an array or holds a single scalar.
+struct ExpressionBindings {
+    static constexpr int MaxSlots = 16;
+
+    const double *streams[MaxSlots] = {};
+    double values[MaxSlots] = {};
+};
+
+// Second-order dual number: a value with its first and second derivative with
+// respect to one variable. Propagating these through the program gives exact
+// derivatives in the same pass as the value, without finite differences.
+struct Jet {
+    double v = 0.0;
+    double d = 0.0;
+    double dd = 0.0;
+};
+
+class CompiledExpression {
+public:
+    // Lanes evaluated per block in evaluateBatch
+    static constexpr int BlockSize = 256;
+    static constexpr int MaxStackDepth = 64;
+    // Highest power of x handled by the fused polynomial and power kernels
+    static constexpr int MaxDegree = 8;
+
+    // Compile the source with the given variable names, slot i is variables[i]
+    bool compile(const QString &source, const QStringList &variables, QString *error = nullptr);
+
+    // Names in source that are neither known variables nor built-in functions and
+    // constants, in order of first use. Equations bind these as free parameters.
+    static QStringList freeNames(const QString &source, const QStringList &known);
+
+    bool isValid() const { return !m_code.empty(); }
+    const QString &source() const { return m_source; }
+    const QStringList &variables() const { return m_variables; }
+    int slotOf(const QString &name) const { return m_variables.indexOf(name); }
+    // Whether the program reads the variable in slot
+    bool usesSlot(int slot) const;
+    ExprShape shape() const { return m_shape; }
+    // Native code tier, null when the platform has none
+    const ExpressionJit *jit() const { return m_jit.get(); }
+
+    // Evaluate a single point
+    double evaluate(const ExpressionBindings &bindings) const;
+
+    // Evaluate count lanes into out, streamed slots are read at the same index.
+    // Runs native code when the JIT tier is enabled, else a fused kernel for
+    // recognized shapes, else the interpreter.
+    void evaluateBatch(const ExpressionBindings &bindings, double *out, int count,
+                       MathMode mode = MathMode::Exact) const;
+
+    // Evaluate a single point together with df/dv and d2f/dv2 for the variable in slot wrt
+    Jet evaluateJet(const ExpressionBindings &bindings, int wrt) const;
+
+    // Batched jet evaluation, d1 and d2 may be null when not needed
+    void evaluateBatchJet(const ExpressionBindings &bindings, int wrt,
+                          double *value, double *d1, double *d2, int count) const;
+
+    // Evaluate over the complex numbers. Each slot holds re + i*im with the
+    // real part bound in re and the imaginary part in im. abs gives the
+    // modulus, log, sqrt and non-integer powers take the principal branch.
+    void evaluateBatchComplex(const ExpressionBindings &re, const ExpressionBindings &im,
+                              double *outRe, double *outIm, int count) const;
+
+private:
+    bool evaluateShape(const ExpressionBindings &bindings, double *out, int count, MathMode mode) const;
+
+    QString m_source;
+    QStringList m_variables;
+    std::vector<ExprNode> m_nodes;
+    std::vector<ExprInstr> m_code;
+    int m_maxDepth = 0;
+
+    // Fused kernel for the whole program, polynomial operands are the
+    // coefficients from x^0 up, wave operands are a, b and c
+    ExprShape m_shape = ExprShape::None;
+    ExprOp m_shapeFunction = ExprOp::Sin;
+    int m_shapePower = 0;
+    std::vector<ExprOperand> m_shapeOperands;
+
+    // Shared by copies, the machine code is generated once on first use
+    std::shared_ptr<const ExpressionJit> m_jit;
+};
+
+#endif
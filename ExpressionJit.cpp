@@ -0,0 +1,412 @@
+#include "ExpressionJit.h"
+#include "FastMath.h"
+#include <QtGlobal>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(Q_PROCESSOR_X86_64) && defined(Q_OS_UNIX)
+#define EXPRESSIONJIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> ExpressionJit::s_enabled{ false };
+
+namespace {
+
+// Routines the generated code calls, each works in place on an array
+using UnaryFunction = void (*)(double *values, int count);
+using PowFunction = void (*)(double *values, const double *exponents, int count);
+
+struct MathFunctions {
+    UnaryFunction unary[int(ExprOp::Exp) + 1];
+    PowFunction pow;
+};
+
+template <double (*F)(double)>
+void exactUnary(double *values, int count)
+{
+    for (int i = 0; i < count; i++)
+        values[i] = F(values[i]);
+}
+
+double libmSin(double x) { return std::sin(x); }
+double libmCos(double x) { return std::cos(x); }
+double libmTan(double x) { return std::tan(x); }
+double libmLog(double x) { return std::log(x); }
+double libmLog10(double x) { return std::log10(x); }
+double libmExp(double x) { return std::exp(x); }
+
+void exactPow(double *values, const double *exponents, int count)
+{
+    for (int i = 0; i < count; i++)
+        values[i] = std::pow(values[i], exponents[i]);
+}
+
+MathFunctions makeFunctions(MathMode mode)
+{
+    MathFunctions functions = {};
+    const bool fast = mode == MathMode::Fast;
+    functions.unary[int(ExprOp::Sin)] = fast ? &FastMath::sin : &exactUnary<libmSin>;
+    functions.unary[int(ExprOp::Cos)] = fast ? &FastMath::cos : &exactUnary<libmCos>;
+    functions.unary[int(ExprOp::Tan)] = fast ? &FastMath::tan : &exactUnary<libmTan>;
+    functions.unary[int(ExprOp::Log)] = fast ? &FastMath::log : &exactUnary<libmLog>;
+    functions.unary[int(ExprOp::Log10)] = fast ? &FastMath::log10 : &exactUnary<libmLog10>;
+    functions.unary[int(ExprOp::Exp)] = fast ? &FastMath::exp : &exactUnary<libmExp>;
+    functions.pow = &exactPow;
+    return functions;
+}
+
+const MathFunctions kExactFunctions = makeFunctions(MathMode::Exact);
+const MathFunctions kFastFunctions = makeFunctions(MathMode::Fast);
+
+#ifdef EXPRESSIONJIT_X86_64
+
+enum Register { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// SSE2 packed double opcodes, all prefixed with 66 0F
+enum SseOp { MovupdLoad = 0x10, MovupdStore = 0x11, Sqrtpd = 0x51, Andpd = 0x54, Xorpd = 0x57,
+             Addpd = 0x58, Mulpd = 0x59, Subpd = 0x5C, Divpd = 0x5E };
+
+// Just enough of an x86-64 encoder for the kernels. Memory operands always use
+// a SIB byte and a 32-bit displacement, which sidesteps the rsp/rbp/r12/r13
+// special cases of the shorter forms.
+class Assembler
+{
+public:
+    std::vector<unsigned char> bytes;
+
+    int size() const { return int(bytes.size()); }
+    void byte(int value) { bytes.push_back((unsigned char)value); }
+
+    void dword(std::int32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            byte((std::uint32_t(value) >> (8 * i)) & 0xff);
+    }
+
+    void patchDword(int at, std::int32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            bytes[at + i] = (unsigned char)((std::uint32_t(value) >> (8 * i)) & 0xff);
+    }
+
+    void rex(bool wide, int reg, int index, int base)
+    {
+        const int value = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0);
+        if (value != 0x40)
+            byte(value);
+    }
+
+    // [base + index + disp], index RSP means none
+    void memory(int reg, int base, int index, std::int32_t disp)
+    {
+        byte(0x84 | ((reg & 7) << 3));
+        byte(((index & 7) << 3) | (base & 7));
+        dword(disp);
+    }
+
+    void gprMemory(bool wide, int opcode, int reg, int base, int index, std::int32_t disp)
+    {
+        rex(wide, reg, index, base);
+        byte(opcode);
+        memory(reg, base, index, disp);
+    }
+
+    void gprRegister(bool wide, int opcode, int reg, int rm)
+    {
+        rex(wide, reg, 0, rm);
+        byte(opcode);
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void sseRegister(SseOp op, int reg, int rm)
+    {
+        byte(0x66);
+        rex(false, reg, 0, rm);
+        byte(0x0F);
+        byte(op);
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void sseMemory(SseOp op, int reg, int base, int index, std::int32_t disp)
+    {
+        byte(0x66);
+        rex(false, reg, index, base);
+        byte(0x0F);
+        byte(op);
+        memory(reg, base, index, disp);
+    }
+
+    // RIP-relative operand, returns the position of the displacement to patch
+    int sseRip(SseOp op, int reg)
+    {
+        byte(0x66);
+        rex(false, reg, 0, 0);
+        byte(0x0F);
+        byte(op);
+        byte(((reg & 7) << 3) | 5);
+        const int at = size();
+        dword(0);
+        return at;
+    }
+
+    void push(int reg)
+    {
+        rex(false, 0, 0, reg);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(int reg)
+    {
+        rex(false, 0, 0, reg);
+        byte(0x58 + (reg & 7));
+    }
+
+    void movRegister(int dst, int src) { gprRegister(true, 0x89, src, dst); }
+
+    // add/sub r64, imm32 through the 81 group
+    void arithmeticImmediate(int extension, int reg, std::int32_t value)
+    {
+        rex(true, 0, 0, reg);
+        byte(0x81);
+        byte(0xC0 | (extension << 3) | (reg & 7));
+        dword(value);
+    }
+
+    void movImmediate32(int reg, std::int32_t value)
+    {
+        rex(false, 0, 0, reg);
+        byte(0xB8 + (reg & 7));
+        dword(value);
+    }
+
+    void callMemory(int base, std::int32_t disp)
+    {
+        rex(false, 0, RSP, base);
+        byte(0xFF);
+        memory(2, base, RSP, disp);
+    }
+
+    // Conditional jump with a 32-bit displacement, returns the position to patch
+    int jump(int condition)
+    {
+        byte(0x0F);
+        byte(0x80 | condition);
+        const int at = size();
+        dword(0);
+        return at;
+    }
+
+    void bindJump(int at, int target) { patchDword(at, target - (at + 4)); }
+};
+
+constexpr int kConditionBelow = 0x2;
+constexpr int kConditionEqual = 0x4;
+
+// Spill area for all 16 xmm registers, plus 8 bytes that realign rsp to 16
+// after the return address and the six saved registers
+constexpr int kFrameSize = 16 * 16 + 8;
+
+#endif
+
+} // namespace
+
+bool ExpressionJit::isSupported()
+{
+#ifdef EXPRESSIONJIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ExpressionJit::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled && isSupported(), std::memory_order_relaxed);
+}
+
+ExpressionJit::ExpressionJit(const std::vector<ExprInstr> &code, int maxDepth)
+    : m_code(code), m_maxDepth(maxDepth)
+{
+}
+
+ExpressionJit::~ExpressionJit()
+{
+#ifdef EXPRESSIONJIT_X86_64
+    if (m_memory)
+        munmap(m_memory, m_mappedSize);
+#endif
+}
+
+void ExpressionJit::generate() const
+{
+#ifdef EXPRESSIONJIT_X86_64
+    if (m_code.empty() || m_maxDepth > MaxDepth)
+        return;
+
+    // Stack entry k lives in xmm k. Saved registers hold the arguments across
+    // calls: r12 lane pointers, r13 lane masks, r14 out, r15 end offset,
+    // rbp the function table and rbx the byte offset of the current lane pair.
+    Assembler a;
+    for (int reg : { RBX, RBP, R12, R13, R14, R15 })
+        a.push(reg);
+    a.arithmeticImmediate(5, RSP, kFrameSize);
+    a.movRegister(R12, RDI);
+    a.movRegister(R13, RSI);
+    a.movRegister(R14, RDX);
+    a.movRegister(R15, RCX);
+    a.movRegister(RBP, R8);
+    a.gprRegister(false, 0x31, RBX, RBX);   // xor ebx, ebx
+    a.gprRegister(true, 0x85, R15, R15);    // test r15, r15
+    const int skipLoop = a.jump(kConditionEqual);
+    const int loop = a.size();
+
+    // Constants are loaded RIP-relative from a pool placed after the code
+    struct Constant {
+        int at;
+        std::uint64_t bits;
+    };
+    std::vector<Constant> constants;
+    auto loadConstant = [&](SseOp op, int reg, std::uint64_t bits) {
+        constants.push_back({ a.sseRip(op, reg), bits });
+    };
+    auto spill = [&](int top) {
+        for (int k = 0; k <= top; k++)
+            a.sseMemory(MovupdStore, k, RSP, RSP, 16 * k);
+    };
+    auto reload = [&](int top) {
+        for (int k = 0; k <= top; k++)
+            a.sseMemory(MovupdLoad, k, RSP, RSP, 16 * k);
+    };
+
+    int sp = -1;
+    for (const ExprInstr &ins : m_code) {
+        switch (ins.op) {
+        case ExprOp::Const: {
+            std::uint64_t bits;
+            std::memcpy(&bits, &ins.value, sizeof(bits));
+            loadConstant(MovupdLoad, ++sp, bits);
+            break;
+        }
+        case ExprOp::Var:
+            // Streams advance with rbx, scalars have a zero mask and stay put
+            ++sp;
+            a.gprMemory(true, 0x8B, RAX, R12, RSP, 8 * ins.slot);   // mov rax, [r12 + 8 * slot]
+            a.movRegister(R11, RBX);
+            a.gprMemory(true, 0x23, R11, R13, RSP, 8 * ins.slot);   // and r11, [r13 + 8 * slot]
+            a.sseMemory(MovupdLoad, sp, RAX, R11, 0);
+            break;
+        case ExprOp::Add:
+            a.sseRegister(Addpd, sp - 1, sp);
+            sp--;
+            break;
+        case ExprOp::Sub:
+            a.sseRegister(Subpd, sp - 1, sp);
+            sp--;
+            break;
+        case ExprOp::Mul:
+            a.sseRegister(Mulpd, sp - 1, sp);
+            sp--;
+            break;
+        case ExprOp::Div:
+            a.sseRegister(Divpd, sp - 1, sp);
+            sp--;
+            break;
+        case ExprOp::Neg:
+            loadConstant(Xorpd, sp, 0x8000000000000000ULL);
+            break;
+        case ExprOp::Abs:
+            loadConstant(Andpd, sp, 0x7fffffffffffffffULL);
+            break;
+        case ExprOp::Sqrt:
+            a.sseRegister(Sqrtpd, sp, sp);
+            break;
+        case ExprOp::Pow:
+            spill(sp);
+            a.gprMemory(true, 0x8D, RDI, RSP, RSP, 16 * (sp - 1));   // lea rdi, [rsp + 16 * (sp - 1)]
+            a.gprMemory(true, 0x8D, RSI, RSP, RSP, 16 * sp);
+            a.movImmediate32(RDX, 2);
+            a.callMemory(RBP, int(offsetof(MathFunctions, pow)));
+            reload(--sp);
+            break;
+        default:
+            // Sin, Cos, Tan, Log, Log10, Exp in place on the spilled pair
+            spill(sp);
+            a.gprMemory(true, 0x8D, RDI, RSP, RSP, 16 * sp);
+            a.movImmediate32(RSI, 2);
+            a.callMemory(RBP, int(offsetof(MathFunctions, unary) + sizeof(UnaryFunction) * size_t(ins.op)));
+            reload(sp);
+            break;
+        }
+    }
+
+    a.sseMemory(MovupdStore, 0, R14, RBX, 0);   // movupd [r14 + rbx], xmm0
+    a.arithmeticImmediate(0, RBX, 16);
+    a.gprRegister(true, 0x39, R15, RBX);        // cmp rbx, r15
+    a.bindJump(a.jump(kConditionBelow), loop);
+
+    a.bindJump(skipLoop, a.size());
+    a.arithmeticImmediate(0, RSP, kFrameSize);
+    for (int reg : { R15, R14, R13, R12, RBP, RBX })
+        a.pop(reg);
+    a.byte(0xC3);   // ret
+
+    // Constant pool, both lanes of each entry hold the same value
+    while (a.size() % 16)
+        a.byte(0xCC);
+    for (const Constant &constant : constants) {
+        a.patchDword(constant.at, a.size() - (constant.at + 4));
+        for (int lane = 0; lane < 2; lane++) {
+            a.dword(std::int32_t(constant.bits & 0xffffffffu));
+            a.dword(std::int32_t(constant.bits >> 32));
+        }
+    }
+
+    // Write the code, then flip the pages to read and execute only
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    const size_t mapped = (a.bytes.size() + page - 1) / page * page;
+    void *memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return;
+    std::memcpy(memory, a.bytes.data(), a.bytes.size());
+    if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mapped);
+        return;
+    }
+
+    m_memory = memory;
+    m_mappedSize = mapped;
+    m_codeSize = a.bytes.size();
+    m_kernel = reinterpret_cast<Kernel>(memory);
+#endif
+}
+
+int ExpressionJit::run(const ExpressionBindings &bindings, double *out, int count, MathMode mode) const
+{
+    std::call_once(m_generated, [this]() { generate(); });
+    const int pairs = count / 2;
+    if (!m_kernel || pairs == 0)
+        return 0;
+
+    // Streamed slots are read at the lane offset, scalars are broadcast from
+    // a pair whose zero mask keeps the offset from moving them
+    double scalars[ExpressionBindings::MaxSlots][2];
+    const double *pointers[ExpressionBindings::MaxSlots];
+    std::uint64_t masks[ExpressionBindings::MaxSlots];
+    for (int slot = 0; slot < ExpressionBindings::MaxSlots; slot++) {
+        if (bindings.streams[slot]) {
+            pointers[slot] = bindings.streams[slot];
+            masks[slot] = ~std::uint64_t(0);
+        } else {
+            scalars[slot][0] = scalars[slot][1] = bindings.values[slot];
+            pointers[slot] = scalars[slot];
+            masks[slot] = 0;
+        }
+    }
+
+    m_kernel(pointers, masks, out, std::int64_t(pairs) * 16,
+             mode == MathMode::Fast ? &kFastFunctions : &kExactFunctions);
+    return pairs * 2;
+}
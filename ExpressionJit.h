@@ -0,0 +1,61 @@
+// ExpressionJit.h
+#ifndef EXPRESSIONJIT_H
+#define EXPRESSIONJIT_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "ExpressionEngine.h"
+
+// Native code tier for compiled expressions. The postfix program is turned
+// into x86-64 SSE2 code that evaluates two lanes per iteration with the
+// expression stack held in xmm registers, so the sample loop runs without
+// any interpreter dispatch. sqrt and abs are inlined, the other functions are
+// calls into the libm or FastMath array routines picked by the MathMode.
+//
+// Code is generated on first use and shared by copies of the expression.
+// Only x86-64 with the System V ABI (Linux, macOS, BSD) is supported, other
+// targets report isSupported() false and stay on the interpreter.
+class ExpressionJit
+{
+public:
+    // Deepest program stack that still fits the 16 xmm registers
+    static constexpr int MaxDepth = 16;
+
+    static bool isSupported();
+
+    // Runtime switch for the tier, off by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    ExpressionJit(const std::vector<ExprInstr> &code, int maxDepth);
+    ~ExpressionJit();
+    ExpressionJit(const ExpressionJit &) = delete;
+    ExpressionJit &operator=(const ExpressionJit &) = delete;
+
+    // Evaluate the leading even number of lanes like evaluateBatch. Returns the
+    // lanes done, 0 when no native code could be generated.
+    int run(const ExpressionBindings &bindings, double *out, int count, MathMode mode) const;
+
+    // Bytes of machine code, 0 before the first run or when generation failed
+    size_t codeSize() const { return m_codeSize; }
+
+private:
+    using Kernel = void (*)(const double *const *pointers, const std::uint64_t *masks, double *out,
+                            std::int64_t bytes, const void *functions);
+
+    void generate() const;
+
+    std::vector<ExprInstr> m_code;
+    int m_maxDepth;
+    mutable std::once_flag m_generated;
+    mutable void *m_memory = nullptr;
+    mutable size_t m_mappedSize = 0;
+    mutable size_t m_codeSize = 0;
+    mutable Kernel m_kernel = nullptr;
+
+    static std::atomic<bool> s_enabled;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "FastMath.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Adding then subtracting 1.5 * 2^52 rounds a double to the nearest integer
+constexpr double kRound = 6755399441055744.0;
+
+// pi/2 in three parts for Cody-Waite reduction, the first two have trailing zero bits
+constexpr double kTwoOverPi = 6.36619772367581382433e-01;
+constexpr double kPio2_1 = 1.57079632673412561417e+00;
+constexpr double kPio2_2 = 6.07710050630396597660e-11;
+constexpr double kPio2_3 = 2.02226624871116645580e-21;
+// Largest |x| reduce() handles, the products k * kPio2_n stop being exact past it
+constexpr double kMaxReduce = 1e5;
+
+constexpr double kLn2Hi = 6.93147180369123816490e-01;
+constexpr double kLn2Lo = 1.90821492927058770002e-10;
+constexpr double kInvLn2 = 1.44269504088896338700e+00;
+constexpr double kInvLn10 = 4.34294481903251827651e-01;
+constexpr double kSqrt2 = 1.41421356237309514547e+00;
+
+// exp(x) is finite and normal between these
+constexpr double kMaxLog = 7.09782712893383973096e+02;
+constexpr double kMinLog = -7.08396418532264106224e+02;
+
+inline double fromBits(std::uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline std::uint64_t toBits(double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Integer conversions go through the bits of k + kRound instead of casts,
+// 64-bit casts between double and integer don't vectorize before AVX-512
+inline std::int64_t roundedToInt(double k)
+{
+    return std::int64_t(toBits(k + kRound) - toBits(kRound));
+}
+
+inline double intToDouble(std::int64_t n)
+{
+    return fromBits(toBits(kRound) + std::uint64_t(n)) - kRound;
+}
+
+// 2^n for n in [-1022, 1023]
+inline double pow2(std::int64_t n)
+{
+    return fromBits(std::uint64_t(n + 1023) << 52);
+}
+
+inline double flipSign(double v, std::uint64_t negate)
+{
+    return fromBits(toBits(v) ^ (negate << 63));
+}
+
+// a when pick is 1, b when it is 0, as a bit blend the compiler keeps branch free
+inline double select(std::uint64_t pick, double a, double b)
+{
+    const std::uint64_t mask = 0 - pick;
+    return fromBits((toBits(a) & mask) | (toBits(b) & ~mask));
+}
+
+// Taylor series of sin and cos on |r| <= pi/4, truncated below 1e-16
+inline double sinPoly(double r)
+{
+    const double r2 = r * r;
+    return r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880 +
+           r2 * (-1.0 / 39916800 + r2 * (1.0 / 6227020800.0 + r2 * (-1.0 / 1307674368000.0)))))));
+}
+
+inline double cosPoly(double r)
+{
+    const double r2 = r * r;
+    return 1.0 + r2 * (-0.5 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320 +
+           r2 * (-1.0 / 3628800 + r2 * (1.0 / 479001600 + r2 * (-1.0 / 87178291200.0 +
+           r2 * (1.0 / 20922789888000.0))))))));
+}
+
+// Reduce x to r in [-pi/4, pi/4] with x = r + q * pi/2
+inline double reduce(double x, std::uint64_t &q)
+{
+    const double k = (x * kTwoOverPi + kRound) - kRound;
+    q = std::uint64_t(roundedToInt(k));
+    return ((x - k * kPio2_1) - k * kPio2_2) - k * kPio2_3;
+}
+
+// sin(x) when shift is 0, cos(x) = sin(x + pi/2) when shift is 1
+inline double sinCos(double x, std::uint64_t shift)
+{
+    std::uint64_t q;
+    const double r = reduce(x, q);
+    q += shift;
+    const double s = sinPoly(r);
+    const double c = cosPoly(r);
+    return flipSign(select(q & 1, c, s), (q >> 1) & 1);
+}
+
+inline double tanKernel(double x)
+{
+    std::uint64_t q;
+    const double r = reduce(x, q);
+    const double s = sinPoly(r);
+    const double c = cosPoly(r);
+    const std::uint64_t odd = q & 1;
+    return flipSign(select(odd, c, s), odd) / select(odd, s, c);
+}
+
+// Apply a kernel built on reduce() to the array. Lanes beyond kMaxReduce take
+// the libm result instead; the scan for them is a cheap reduction and when
+// there are none the kernel loop stays free of calls.
+template <typename Kernel, typename Exact>
+void reduced(double *values, int count, Kernel kernel, Exact exact)
+{
+    // Selecting a double and or-ing its bits vectorizes with SSE2, a bool or
+    // integer flag per lane does not
+    std::uint64_t large = 0;
+    for (int i = 0; i < count; i++)
+        large |= toBits(std::fabs(values[i]) > kMaxReduce ? 1.0 : 0.0);
+
+    if (!large) {
+        for (int i = 0; i < count; i++)
+            values[i] = kernel(values[i]);
+        return;
+    }
+    for (int i = 0; i < count; i++)
+        values[i] = std::fabs(values[i]) > kMaxReduce ? exact(values[i]) : kernel(values[i]);
+}
+
+} // namespace
+
+// The reduction turns -0 into +0, sin and tan hand zeros back unchanged to keep their sign
+void FastMath::sin(double *values, int count)
+{
+    reduced(values, count, [](double x) { return x == 0.0 ? x : sinCos(x, 0); },
+            [](double x) { return std::sin(x); });
+}
+
+void FastMath::cos(double *values, int count)
+{
+    reduced(values, count, [](double x) { return sinCos(x, 1); }, [](double x) { return std::cos(x); });
+}
+
+void FastMath::tan(double *values, int count)
+{
+    reduced(values, count, [](double x) { return x == 0.0 ? x : tanKernel(x); },
+            [](double x) { return std::tan(x); });
+}
+
+void FastMath::exp(double *values, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const double x = values[i];
+
+        // Past the ends of the normal range k and the scaling below are
+        // garbage, those results are patched at the end
+        const double k = (x * kInvLn2 + kRound) - kRound;
+        const double r = (x - k * kLn2Hi) - k * kLn2Lo;
+
+        // Taylor series on |r| <= ln2/2, truncated below 1e-17
+        double p = 1.0 / 6227020800.0;
+        p = p * r + 1.0 / 479001600;
+        p = p * r + 1.0 / 39916800;
+        p = p * r + 1.0 / 3628800;
+        p = p * r + 1.0 / 362880;
+        p = p * r + 1.0 / 40320;
+        p = p * r + 1.0 / 5040;
+        p = p * r + 1.0 / 720;
+        p = p * r + 1.0 / 120;
+        p = p * r + 1.0 / 24;
+        p = p * r + 1.0 / 6;
+        p = p * r + 0.5;
+        p = p * r * r + r + 1.0;
+
+        // Scale in two steps, 2^n alone overflows for n = 1024
+        const std::int64_t n = roundedToInt(k);
+        const std::int64_t half = std::int64_t(std::uint64_t(n + 2048) >> 1) - 1024;
+        double result = p * pow2(half) * pow2(n - half);
+
+        // Subnormal results flush to zero
+        result = x > kMaxLog ? std::numeric_limits<double>::infinity() : result;
+        result = x < kMinLog ? 0.0 : result;
+        values[i] = x != x ? x : result;
+    }
+}
+
+void FastMath::log(double *values, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const double x = values[i];
+
+        // Bring subnormals into the normal range first. The exponent stays a
+        // double, so every select compares doubles and vectorizes with SSE2
+        const double scaled = x < DBL_MIN ? x * 18014398509481984.0 : x;
+        const std::uint64_t bits = toBits(scaled);
+        double ed = intToDouble(std::int64_t((bits >> 52) & 0x7ff)) - (x < DBL_MIN ? 1077.0 : 1023.0);
+        double m = fromBits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+
+        // m in [sqrt(2)/2, sqrt(2)) keeps the series argument small
+        ed += m > kSqrt2 ? 1.0 : 0.0;
+        m = m > kSqrt2 ? m * 0.5 : m;
+
+        // log(m) = 2 atanh(s) with s = (m - 1) / (m + 1), |s| <= 0.1716
+        const double f = m - 1.0;
+        const double s = f / (2.0 + f);
+        const double s2 = s * s;
+        const double series = s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9 + s2 * (1.0 / 11 +
+                              s2 * (1.0 / 13 + s2 * (1.0 / 15 + s2 * (1.0 / 17 + s2 * (1.0 / 19)))))))));
+        const double result = ed * kLn2Hi + (f - s * (f - 2.0 * series) + ed * kLn2Lo);
+
+        double v = result;
+        v = x == std::numeric_limits<double>::infinity() ? x : v;
+        v = x == 0.0 ? -std::numeric_limits<double>::infinity() : v;
+        v = !(x >= 0.0) ? std::numeric_limits<double>::quiet_NaN() : v;
+        values[i] = v;
+    }
+}
+
+void FastMath::log10(double *values, int count)
+{
+    log(values, count);
+    for (int i = 0; i < count; i++)
+        values[i] *= kInvLn10;
+}
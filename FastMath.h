@@ -0,0 +1,29 @@
+// FastMath.h
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+// Polynomial approximations of the transcendental functions for previews.
+// Each kernel transforms an array in place with straight-line code (range
+// reduction through rounding tricks, Horner polynomials, selects instead of
+// branches) that compilers vectorize, unlike calls into libm.
+//
+// Maximum errors against libm, measured over the stated ranges:
+//   sin, cos   |x| <= 1e5        2 ULP (reduction by 3-part pi/2)
+//   tan        |x| <= 1e5        4 ULP away from poles
+//   exp        all x             1 ULP, subnormal results flush to 0
+//   log        all x > 0         1 ULP, log10 2 ULP
+// Special values (signed zeros, negative, inf, NaN) give the libm results.
+// The reduction is only exact up to |x| = 1e5, sin/cos/tan hand lanes beyond
+// it to libm, so those cost a libm call but are as accurate as libm.
+class FastMath
+{
+public:
+    static void sin(double *values, int count);
+    static void cos(double *values, int count);
+    static void tan(double *values, int count);
+    static void exp(double *values, int count);
+    static void log(double *values, int count);
+    static void log10(double *values, int count);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "HeatmapRenderer.h"
+#include "ColorMap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+HeatmapRenderer::HeatmapRenderer()
+    : m_lut(ColorMap::viridis())
+{
+}
+
+bool HeatmapRenderer::setExpression(const QString &source, const QStringList &parameters, QString *error)
+{
+    m_tiles.clear();
+    m_parameters.fill(0.0, parameters.size());
+    return m_expr.compile(source, QStringList{ "x", "y" } + parameters, error);
+}
+
+void HeatmapRenderer::setParameters(const QVector<double> &values)
+{
+    if (values == m_parameters)
+        return;
+    m_parameters = values;
+    m_tiles.clear();
+}
+
+void HeatmapRenderer::setMathMode(MathMode mode)
+{
+    if (mode == m_mathMode)
+        return;
+    m_mathMode = mode;
+    m_tiles.clear();
+}
+
+void HeatmapRenderer::computeTile(const TileKey &key, Tile &tile) const
+{
+    constexpr int TileSize = Tiles::TileSize;
+    double xs[TileSize];
+    double row[TileSize];
+    for (int u = 0; u < TileSize; u++)
+        xs[u] = Tiles::x(key, u);
+
+    ExpressionBindings bindings;
+    bindings.streams[0] = xs;
+    for (int k = 0; k < m_parameters.size() && 2 + k < ExpressionBindings::MaxSlots; k++)
+        bindings.values[2 + k] = m_parameters[k];
+
+    tile.z.resize(TileSize * TileSize);
+    float zMin = std::numeric_limits<float>::infinity();
+    float zMax = -std::numeric_limits<float>::infinity();
+
+    // One batched evaluation per tile row, y is constant along the row
+    for (int v = 0; v < TileSize; v++) {
+        bindings.values[1] = Tiles::y(key, v);
+        m_expr.evaluateBatch(bindings, row, TileSize, m_mathMode);
+
+        float *dst = tile.z.data() + v * TileSize;
+        for (int u = 0; u < TileSize; u++) {
+            const float z = float(row[u]);
+            dst[u] = z;
+            if (std::isfinite(z)) {
+                zMin = std::min(zMin, z);
+                zMax = std::max(zMax, z);
+            }
+        }
+    }
+
+    tile.zMin = zMin;
+    tile.zMax = zMax;
+}
+
+QImage HeatmapRenderer::render(const QRectF &world, const QSize &pixels)
+{
+    QImage image(pixels, QImage::Format_ARGB32_Premultiplied);
+    if (pixels.isEmpty() || world.isEmpty() || !m_expr.isValid()) {
+        image.fill(Qt::transparent);
+        return image;
+    }
+
+    const QVector<const Tile *> &visible =
+        m_tiles.update(world, pixels, [this](const TileKey &key, Tile &tile) { computeTile(key, tile); });
+
+    float zMin = std::numeric_limits<float>::infinity();
+    float zMax = -std::numeric_limits<float>::infinity();
+    for (const Tile *tile : visible) {
+        zMin = std::min(zMin, tile->zMin);
+        zMax = std::max(zMax, tile->zMax);
+    }
+    const float scale = zMax > zMin ? 255.0f / (zMax - zMin) : 0.0f;
+
+    // Map values through the LUT straight into the image
+    const QRgb *lut = m_lut.constData();
+    m_tiles.forEachSpan(image, [&](QRgb *line, const Tile &tile, int offset, int count) {
+        const float *src = tile.z.constData() + offset;
+        for (int k = 0; k < count; k++) {
+            const float z = src[k];
+            line[k] = std::isfinite(z) ? lut[qBound(0, int((z - zMin) * scale), 255)] : 0;
+        }
+    });
+    return image;
+}
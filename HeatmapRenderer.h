@@ -0,0 +1,56 @@
+// HeatmapRenderer.h
+#ifndef HEATMAPRENDERER_H
+#define HEATMAPRENDERER_H
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include "ExpressionEngine.h"
+#include "TileCache.h"
+
+// Renders z = f(x, y) over a viewport as a colour-mapped image. The values are
+// computed per tile of a TileCache, so panning and zooming back reuse them;
+// the colour range is taken over the visible tiles on every render.
+class HeatmapRenderer
+{
+public:
+    HeatmapRenderer();
+
+    // Compile f(x, y) with the given free parameters bound after x and y
+    bool setExpression(const QString &source, const QStringList &parameters = QStringList(), QString *error = nullptr);
+    const CompiledExpression &expression() const { return m_expr; }
+
+    // Values of the free parameters in setExpression order, changes drop the cached tiles
+    void setParameters(const QVector<double> &values);
+
+    // Fast math for interactive rendering, changes drop the cached tiles
+    void setMathMode(MathMode mode);
+    MathMode mathMode() const { return m_mathMode; }
+
+    // Render the world rectangle (x = left..right, y = top..bottom with top < bottom)
+    // into an image of the given pixel size
+    QImage render(const QRectF &world, const QSize &pixels);
+
+    void clearCache() { m_tiles.clear(); }
+    int lastComputedTiles() const { return m_tiles.lastComputed(); }
+    int lastVisibleTiles() const { return m_tiles.lastVisible(); }
+
+private:
+    struct Tile {
+        QVector<float> z;
+        float zMin = 0.0f;
+        float zMax = 0.0f;
+    };
+    using Tiles = TileCache<Tile>;
+
+    void computeTile(const TileKey &key, Tile &tile) const;
+
+    CompiledExpression m_expr;
+    QVector<double> m_parameters;
+    MathMode m_mathMode = MathMode::Exact;
+    Tiles m_tiles;
+    QVector<QRgb> m_lut;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "IteratedMap.h"
+#include "SampleBufferPool.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+bool IteratedMap::compute(const CompiledExpression &map, const ExpressionBindings &bindings, const QRectF &world,
+                          const QSize &pixels, const Settings &settings, MathMode mode)
+{
+    // Slot 1 is r, the slots after it are the parameters
+    const QVector<double> values(bindings.values + 2, bindings.values + std::max<int>(2, map.variables().size()));
+    if (!isEmpty() && map.source() == m_source && map.variables() == m_variables && values == m_values &&
+        world == m_world && pixels == m_pixels && settings == m_settings && mode == m_mode)
+        return false;
+
+    clear();
+    if (!map.isValid() || pixels.isEmpty() || world.isEmpty() || settings.samplesPerColumn < 1)
+        return true;
+    m_source = map.source();
+    m_variables = map.variables();
+    m_values = values;
+    m_world = world;
+    m_settings = settings;
+    m_mode = mode;
+
+    const int columns = pixels.width();
+    const int rows = pixels.height();
+    m_pixels = pixels;
+    m_counts.fill(0, qsizetype(columns) * rows);
+
+    // Whole columns per task, as many as fit in one evaluateBatch block
+    const int spc = settings.samplesPerColumn;
+    const int columnsPerTask = std::max(1, CompiledExpression::BlockSize / spc);
+    struct Task {
+        int firstColumn;
+        int columnCount;
+        qint64 evaluations;
+    };
+    QVector<Task> tasks;
+    for (int c = 0; c < columns; c += columnsPerTask)
+        tasks.append({ c, std::min(columnsPerTask, columns - c), 0 });
+
+    const double columnWidth = world.width() / columns;
+    const double rowScale = rows / world.height();
+    quint32 *counts = m_counts.data();
+    QtConcurrent::blockingMap(tasks, [&](Task &task) {
+        const int lanes = task.columnCount * spc;
+        SampleBuffer xs(lanes);
+        SampleBuffer next(lanes);
+        SampleBuffer rs(lanes);
+        for (int lane = 0; lane < lanes; lane++) {
+            const int column = task.firstColumn + lane / spc;
+            rs[lane] = world.left() + (column + (lane % spc + 0.5) / spc) * columnWidth;
+            xs[lane] = settings.x0;
+        }
+
+        ExpressionBindings local = bindings;
+        local.streams[1] = rs.constData();
+        const int total = settings.transient + settings.iterations;
+        int done = 0;
+        for (; done < total; done++) {
+            local.streams[0] = xs.constData();
+            map.evaluateBatch(local, next.data(), lanes, mode);
+            std::swap(xs, next);
+            if (done < settings.transient)
+                continue;
+
+            // Count the new states, orbits that escaped to infinity or NaN
+            // never come back, so a block with none left stops early
+            bool alive = false;
+            const double *x = xs.constData();
+            for (int lane = 0; lane < lanes; lane++) {
+                alive = alive || std::isfinite(x[lane]);
+                const double row = (world.bottom() - x[lane]) * rowScale;
+                if (row >= 0.0 && row < rows)
+                    counts[qsizetype(task.firstColumn + lane / spc) * rows + int(row)]++;
+            }
+            if (!alive) {
+                done++;
+                break;
+            }
+        }
+        task.evaluations = qint64(done) * lanes;
+    });
+
+    for (const Task &task : tasks)
+        m_evaluations += task.evaluations;
+    return true;
+}
+
+void IteratedMap::clear()
+{
+    m_counts.clear();
+    m_pixels = QSize();
+    m_evaluations = 0;
+    m_image = QImage();
+}
+
+QImage IteratedMap::render(const QColor &color)
+{
+    if (!m_image.isNull() && color == m_imageColor)
+        return m_image;
+
+    QImage image(m_pixels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    m_image = image;
+    m_imageColor = color;
+    if (isEmpty())
+        return image;
+
+    const quint32 maxCount = *std::max_element(m_counts.constBegin(), m_counts.constEnd());
+    if (maxCount == 0)
+        return image;
+
+    // Log scale, so orbits spread over many rows stay visible next to fixed points
+    const double scale = 255.0 / std::log1p(double(maxCount));
+    const int columns = m_pixels.width();
+    const int rows = m_pixels.height();
+    for (int row = 0; row < rows; row++) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(row));
+        for (int column = 0; column < columns; column++) {
+            const quint32 count = m_counts[qsizetype(column) * rows + row];
+            if (count == 0)
+                continue;
+            const int alpha = std::clamp(int(std::log1p(double(count)) * scale + 0.5), 1, 255);
+            line[column] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), alpha));
+        }
+    }
+    m_image = image;
+    return image;
+}
@@ -0,0 +1,68 @@
+// IteratedMap.h
+#ifndef ITERATEDMAP_H
+#define ITERATEDMAP_H
+
+#include <QColor>
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include "ExpressionEngine.h"
+
+// Bifurcation diagrams of x <- f(x, r), with x in slot 0 and r in slot 1.
+// r runs along the horizontal axis with a few values per pixel column; every
+// value is one lane of a batch, so each iteration is a single evaluateBatch
+// call over a block of lanes, running the fused kernels or the JIT instead of
+// one interpreted call per point. Blocks of columns are iterated in parallel
+// and the visited x values are counted into a per-pixel density, drawn as one
+// image instead of millions of chart points.
+class IteratedMap
+{
+public:
+    struct Settings {
+        double x0 = 0.5;
+        int transient = 500;        // iterations discarded while the orbit settles
+        int iterations = 1000;      // iterations counted per r value
+        int samplesPerColumn = 4;   // r values per pixel column
+
+        bool operator==(const Settings &other) const
+        {
+            return x0 == other.x0 && transient == other.transient && iterations == other.iterations &&
+                   samplesPerColumn == other.samplesPerColumn;
+        }
+    };
+
+    // Iterate over the world rectangle (y = top..bottom with top < bottom)
+    // at the given image size. bindings holds the slots after r. The counts
+    // are kept when the map, parameters, ranges and settings match the last
+    // call; returns whether it iterated.
+    bool compute(const CompiledExpression &map, const ExpressionBindings &bindings, const QRectF &world,
+                 const QSize &pixels, const Settings &settings, MathMode mode = MathMode::Exact);
+    void clear();
+
+    bool isEmpty() const { return m_counts.isEmpty(); }
+    // Map evaluations of the last compute()
+    qint64 evaluations() const { return m_evaluations; }
+
+    // Density on a log scale, transparent where no orbit passed. The image is
+    // reused until the counts or the color change.
+    QImage render(const QColor &color);
+
+private:
+    QVector<quint32> m_counts;   // column-major, so each block of columns owns its range
+    QSize m_pixels;
+    qint64 m_evaluations = 0;
+
+    // Inputs of the counts, compared on the next compute()
+    QString m_source;
+    QStringList m_variables;
+    QVector<double> m_values;
+    QRectF m_world;
+    Settings m_settings;
+    MathMode m_mode = MathMode::Exact;
+
+    QImage m_image;
+    QColor m_imageColor;
+};
+
+#endif
@@ -0,0 +1,297 @@
+#include "OdeSolver.h"
+#include "SampleBufferPool.h"
+#include <QStringList>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+OdeSolver::Statistics OdeSolver::integrate(const CompiledExpression &rhs, const ExpressionBindings &bindings,
+                                           double x0, double y0, double direction, double xMin, double xMax,
+                                           double yLimitLow, double yLimitHigh, double tolerance,
+                                           double outputStep, QVector<double> &xs, QVector<double> &ys)
+{
+    Statistics stats;
+    const double xEnd = direction > 0.0 ? xMax : xMin;
+    if (!(direction * (xEnd - x0) > 0.0) || !std::isfinite(y0))
+        return stats;
+
+    ExpressionBindings local = bindings;
+    local.streams[0] = nullptr;
+    local.streams[1] = nullptr;
+    auto f = [&](double x, double y) {
+        local.values[0] = x;
+        local.values[1] = y;
+        stats.evaluations++;
+        return rhs.evaluate(local);
+    };
+    auto scale = [tolerance](double a, double b) {
+        return tolerance + tolerance * std::max(std::fabs(a), std::fabs(b));
+    };
+
+    double x = x0;
+    double y = y0;
+    double k1 = f(x, y);
+    if (!std::isfinite(k1))
+        return stats;
+
+    // Starting step from the size of y and its first two derivatives (Hairer,
+    // Norsett and Wanner), one evaluation instead of a string of rejections
+    const double span = std::fabs(xEnd - x0);
+    double h;
+    {
+        const double sc = scale(y, y);
+        const double d0 = std::fabs(y) / sc;
+        const double d1 = std::fabs(k1) / sc;
+        const double h0 = std::min(span, d0 < 1e-5 || d1 < 1e-5 ? 1e-6 * span : 0.01 * d0 / d1);
+        const double k = f(x + direction * h0, y + direction * h0 * k1);
+        const double d2 = std::fabs(k - k1) / sc / h0;
+        const double d = std::max(d1, d2);
+        const double h1 = d <= 1e-15 ? std::max(1e-6 * span, h0 * 1e-3) : std::pow(0.01 / d, 0.2);
+        h = std::min({ 100.0 * h0, h1, span });
+    }
+    const double minStep = 1e-12 * (xMax - xMin);
+
+    // Output samples on the global grid, the first one beyond x0
+    const int lastIndex = int(std::floor((xMax - xMin) / outputStep + 1e-9));
+    int next = direction > 0.0 ? std::max(0, int(std::floor((x0 - xMin) / outputStep)) + 1)
+                               : std::min(lastIndex, int(std::ceil((x0 - xMin) / outputStep)) - 1);
+
+    bool rejectedLast = false;
+    for (int attempt = 0; attempt < MaxSteps && direction * (xEnd - x) > 0.0; attempt++) {
+        h = std::min(h, std::fabs(xEnd - x));
+        const double s = direction * h;
+
+        // Dormand-Prince stages, k7 is f at the new point and becomes the next k1
+        const double k2 = f(x + s / 5.0, y + s * (k1 / 5.0));
+        const double k3 = f(x + 3.0 * s / 10.0, y + s * (3.0 / 40.0 * k1 + 9.0 / 40.0 * k2));
+        const double k4 = f(x + 4.0 * s / 5.0, y + s * (44.0 / 45.0 * k1 - 56.0 / 15.0 * k2 + 32.0 / 9.0 * k3));
+        const double k5 = f(x + 8.0 * s / 9.0,
+                            y + s * (19372.0 / 6561.0 * k1 - 25360.0 / 2187.0 * k2 + 64448.0 / 6561.0 * k3 -
+                                     212.0 / 729.0 * k4));
+        const double k6 = f(x + s,
+                            y + s * (9017.0 / 3168.0 * k1 - 355.0 / 33.0 * k2 + 46732.0 / 5247.0 * k3 +
+                                     49.0 / 176.0 * k4 - 5103.0 / 18656.0 * k5));
+        const double yNew = y + s * (35.0 / 384.0 * k1 + 500.0 / 1113.0 * k3 + 125.0 / 192.0 * k4 -
+                                     2187.0 / 6784.0 * k5 + 11.0 / 84.0 * k6);
+        const double k7 = f(x + s, yNew);
+
+        // Difference of the fifth and embedded fourth order solutions
+        const double error = s * (71.0 / 57600.0 * k1 - 71.0 / 16695.0 * k3 + 71.0 / 1920.0 * k4 -
+                                  17253.0 / 339200.0 * k5 + 22.0 / 525.0 * k6 - 1.0 / 40.0 * k7);
+        const double norm = std::fabs(error) / scale(y, yNew);
+
+        if (!(norm <= 1.0)) {
+            // Too large or not finite: shrink and retry, a solution that keeps
+            // failing at the smallest step has run into a singularity
+            stats.rejected++;
+            h *= std::isfinite(norm) ? std::max(0.2, 0.9 * std::pow(norm, -0.2)) : 0.25;
+            rejectedLast = true;
+            if (h < minStep)
+                break;
+            continue;
+        }
+        stats.steps++;
+
+        // Grid samples inside the step from the fourth order continuous extension
+        // of the method, built from the stages already evaluated
+        const double xNew = x + s;
+        const double difference = yNew - y;
+        const double r3 = s * k1 - difference;
+        const double r4 = difference - s * k7 - r3;
+        const double r5 = s * (-12715105075.0 / 11282082432.0 * k1 + 87487479700.0 / 32700410799.0 * k3 -
+                               10690763975.0 / 1880347072.0 * k4 + 701980252875.0 / 199316789632.0 * k5 -
+                               1453857185.0 / 822651844.0 * k6 + 69997945.0 / 29380423.0 * k7);
+        while (next >= 0 && next <= lastIndex) {
+            const double gx = xMin + next * outputStep;
+            if (direction * (gx - xNew) > 0.0)
+                break;
+            const double t = (gx - x) / s;
+            const double u = 1.0 - t;
+            xs.append(gx);
+            ys.append(y + t * (difference + u * (r3 + t * (r4 + u * r5))));
+            next += direction > 0.0 ? 1 : -1;
+        }
+
+        x = xNew;
+        y = yNew;
+        k1 = k7;
+        if (!std::isfinite(y) || !std::isfinite(k1) || y < yLimitLow || y > yLimitHigh)
+            break;
+
+        // Grow at most 5x, and not at all right after a rejection
+        const double growth = norm == 0.0 ? 5.0 : std::min(5.0, 0.9 * std::pow(norm, -0.2));
+        h *= rejectedLast ? std::min(1.0, growth) : growth;
+        rejectedLast = false;
+    }
+
+    // Finish on the last point reached unless it was a grid sample
+    if (x != x0 && x >= xMin && x <= xMax && (xs.isEmpty() || xs.last() != x)) {
+        xs.append(x);
+        ys.append(y);
+    }
+    return stats;
+}
+
+OdeSolver::Statistics OdeSolver::solve(const CompiledExpression &rhs, const ExpressionBindings &bindings,
+                                       const QVector<QPointF> &initialValues, double xMin, double xMax,
+                                       double yMin, double yMax, double tolerance, double outputStep,
+                                       SegmentedCurve &curve)
+{
+    Statistics total;
+    curve.clear();
+    if (!rhs.isValid() || initialValues.isEmpty() || xMin >= xMax || outputStep <= 0.0)
+        return total;
+
+    // Backward and forward half of every solution, so each initial value is two tasks
+    struct Task {
+        QPointF start;
+        double direction;
+        QVector<double> xs;
+        QVector<double> ys;
+        Statistics stats;
+    };
+    const int values = std::min(int(initialValues.size()), MaxInitialValues);
+    QVector<Task> tasks;
+    tasks.reserve(2 * values);
+    for (int i = 0; i < values; i++) {
+        tasks.append({ initialValues[i], -1.0, {}, {}, {} });
+        tasks.append({ initialValues[i], 1.0, {}, {}, {} });
+    }
+
+    // Solutions may leave the view and come back, they are only given up far outside it
+    const double margin = 10.0 * (yMax - yMin);
+    QtConcurrent::blockingMap(tasks, [&](Task &task) {
+        task.stats = integrate(rhs, bindings, task.start.x(), task.start.y(), task.direction, xMin, xMax,
+                               yMin - margin, yMax + margin, tolerance, outputStep, task.xs, task.ys);
+    });
+
+    // Backward half reversed, the initial value, then the forward half, with a
+    // NaN between solutions to break the curve
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    qsizetype count = 0;
+    for (const Task &task : tasks)
+        count += task.xs.size() + 1;
+    SampleBuffer xs;
+    SampleBuffer ys;
+    xs.resize(count + values);
+    ys.resize(count + values);
+    qsizetype n = 0;
+    for (int i = 0; i < values; i++) {
+        const Task &backward = tasks[2 * i];
+        const Task &forward = tasks[2 * i + 1];
+        for (qsizetype k = backward.xs.size() - 1; k >= 0; k--) {
+            xs[n] = backward.xs[k];
+            ys[n++] = backward.ys[k];
+        }
+        if (backward.start.x() >= xMin && backward.start.x() <= xMax) {
+            xs[n] = backward.start.x();
+            ys[n++] = backward.start.y();
+        }
+        for (qsizetype k = 0; k < forward.xs.size(); k++) {
+            xs[n] = forward.xs[k];
+            ys[n++] = forward.ys[k];
+        }
+        xs[n] = nan;
+        ys[n++] = nan;
+
+        for (const Task *task : { &backward, &forward }) {
+            total.steps += task->stats.steps;
+            total.rejected += task->stats.rejected;
+            total.evaluations += task->stats.evaluations;
+        }
+    }
+    curve.build(xs.constData(), ys.constData(), int(n), yMin, yMax);
+    return total;
+}
+
+void OdeSolver::directionField(const CompiledExpression &rhs, const ExpressionBindings &bindings,
+                               const QRectF &world, const QSizeF &pixels, int columns, int rows,
+                               double length, SegmentedCurve &field)
+{
+    field.clear();
+    const int count = columns * rows;
+    if (!rhs.isValid() || count <= 0 || world.isEmpty() || pixels.isEmpty())
+        return;
+
+    // Cell centres, the slopes of the whole grid are a single batch
+    SampleBuffer xs(count);
+    SampleBuffer ys(count);
+    SampleBuffer slopes(count);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            xs[r * columns + c] = world.left() + (c + 0.5) * world.width() / columns;
+            ys[r * columns + c] = world.top() + (r + 0.5) * world.height() / rows;
+        }
+    }
+    ExpressionBindings local = bindings;
+    local.streams[0] = xs.constData();
+    local.streams[1] = ys.constData();
+    rhs.evaluateBatch(local, slopes.data(), count);
+
+    // Segments of equal length on screen, centred on their cell and separated
+    // by NaNs so each one is its own piece of the curve
+    const double sx = pixels.width() / world.width();
+    const double sy = pixels.height() / world.height();
+    const double half = 0.5 * length;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    SampleBuffer px(3 * count);
+    SampleBuffer py(3 * count);
+    for (int i = 0; i < count; i++) {
+        const double slope = slopes[i];
+        double dx = 0.0;
+        double dy = half / sy;
+        if (!std::isinf(slope)) {
+            dx = half / std::hypot(sx, slope * sy);
+            dy = slope * dx;
+        }
+        px[3 * i] = xs[i] - dx;
+        py[3 * i] = ys[i] - dy;
+        px[3 * i + 1] = xs[i] + dx;
+        py[3 * i + 1] = ys[i] + dy;
+        px[3 * i + 2] = nan;
+        py[3 * i + 2] = nan;
+    }
+    field.build(px.constData(), py.constData(), 3 * count, world.top(), world.bottom());
+}
+
+QVector<QPointF> OdeSolver::parseInitialValues(const QString &text, QString *error)
+{
+    QVector<QPointF> values;
+    const QStringList entries = text.split(';', Qt::SkipEmptyParts);
+    for (const QString &entry : entries) {
+        if (entry.trimmed().isEmpty())
+            continue;
+        const QStringList parts = entry.split(',');
+        bool okX = false;
+        bool okY = false;
+        const double x = parts.size() == 2 ? parts[0].trimmed().toDouble(&okX) : 0.0;
+        const double y = parts.size() == 2 ? parts[1].trimmed().toDouble(&okY) : 0.0;
+        if (!okX || !okY) {
+            if (error)
+                *error = QString("'%1' is not a pair x0, y0").arg(entry.trimmed());
+            return QVector<QPointF>();
+        }
+        values.append(QPointF(x, y));
+    }
+
+    QString message;
+    if (values.isEmpty())
+        message = "Enter at least one initial value x0, y0";
+    else if (values.size() > MaxInitialValues)
+        message = QString("At most %1 initial values are solved").arg(MaxInitialValues);
+    if (!message.isEmpty()) {
+        if (error)
+            *error = message;
+        return QVector<QPointF>();
+    }
+    return values;
+}
+
+QString OdeSolver::formatInitialValues(const QVector<QPointF> &values)
+{
+    QStringList entries;
+    for (const QPointF &value : values)
+        entries.append(QString("%1, %2").arg(value.x(), 0, 'g', 10).arg(value.y(), 0, 'g', 10));
+    return entries.join("; ");
+}
@@ -0,0 +1,59 @@
+// OdeSolver.h
+#ifndef ODESOLVER_H
+#define ODESOLVER_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include "ExpressionEngine.h"
+#include "SegmentedCurve.h"
+
+// Solution curves and direction fields of y' = f(x, y), with x in slot 0 and
+// y in slot 1 of the compiled right-hand side. Solutions are integrated with
+// the adaptive Dormand-Prince 5(4) pair: six evaluations per step thanks to
+// first-same-as-last, a step size chosen from the embedded error estimate and
+// output points interpolated between steps, so the step count follows the
+// tolerance rather than the drawing resolution. Initial values are integrated
+// in parallel, one task per value and direction.
+class OdeSolver
+{
+public:
+    // Accepted plus rejected steps per direction before a solution is cut off
+    static constexpr int MaxSteps = 100000;
+    static constexpr int MaxInitialValues = 256;
+
+    struct Statistics {
+        qint64 steps = 0;
+        qint64 rejected = 0;
+        qint64 evaluations = 0;
+    };
+
+    // Integrate through every (x0, y0) forwards to xMax and backwards to xMin
+    // with relative and absolute tolerance, sampled at xMin + j * outputStep.
+    // All solutions go into curve, broken where they leave yMin..yMax.
+    static Statistics solve(const CompiledExpression &rhs, const ExpressionBindings &bindings,
+                            const QVector<QPointF> &initialValues, double xMin, double xMax,
+                            double yMin, double yMax, double tolerance, double outputStep,
+                            SegmentedCurve &curve);
+
+    // Slope segments of the given length in pixels on a columns x rows grid over
+    // the world rectangle (y = top..bottom with top < bottom) shown at pixels.
+    // All slopes are evaluated as one batch.
+    static void directionField(const CompiledExpression &rhs, const ExpressionBindings &bindings,
+                               const QRectF &world, const QSizeF &pixels, int columns, int rows,
+                               double length, SegmentedCurve &field);
+
+    // "x0, y0; x0, y0; ..." lists of initial values
+    static QVector<QPointF> parseInitialValues(const QString &text, QString *error = nullptr);
+    static QString formatInitialValues(const QVector<QPointF> &values);
+
+private:
+    static Statistics integrate(const CompiledExpression &rhs, const ExpressionBindings &bindings,
+                                double x0, double y0, double direction, double xMin, double xMax,
+                                double yLimitLow, double yLimitHigh, double tolerance, double outputStep,
+                                QVector<double> &xs, QVector<double> &ys);
+};
+
+#endif
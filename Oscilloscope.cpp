@@ -0,0 +1,93 @@
+#include "Oscilloscope.h"
+#include <QtConcurrent>
+#include <algorithm>
+
+Oscilloscope::~Oscilloscope()
+{
+    m_future.waitForFinished();
+}
+
+void Oscilloscope::clear()
+{
+    m_future.waitForFinished();
+    m_traces.clear();
+    m_pending = false;
+}
+
+void Oscilloscope::addTrace(const QString &name, const CompiledExpression &expression,
+                            const ExpressionBindings &bindings)
+{
+    m_future.waitForFinished();
+    Trace trace;
+    trace.name = name;
+    trace.expression = expression;
+    trace.bindings = bindings;
+    m_traces.append(trace);
+}
+
+void Oscilloscope::submit(double time, double xMin, double step, int count, double yMin, double yMax,
+                          MathMode mode)
+{
+    m_future.waitForFinished();
+
+    // Pooled buffers keep their capacity, resizing to the same count is free
+    m_xs.resize(count);
+    double *xs = m_xs.data();
+    for (int j = 0; j < count; j++)
+        xs[j] = xMin + j * step;
+
+    m_time = time;
+    m_pending = true;
+    m_future = QtConcurrent::map(m_traces, [xs, time, count, yMin, yMax, mode](Trace &trace) {
+        trace.ys.resize(count);
+        ExpressionBindings bindings = trace.bindings;
+        bindings.values[TimeSlot] = time;
+        bindings.streams[0] = xs;
+        trace.expression.evaluateBatch(bindings, trace.ys.data(), count, mode);
+
+        // Edges are bisected with t bound as a scalar
+        bindings.streams[0] = nullptr;
+        trace.curves[1 - trace.front].build(xs, trace.ys.constData(), count, yMin, yMax,
+                                             &trace.expression, bindings);
+    });
+}
+
+bool Oscilloscope::collect()
+{
+    if (!m_pending || m_future.isRunning())
+        return false;
+    m_future.waitForFinished();
+    for (Trace &trace : m_traces)
+        trace.front = 1 - trace.front;
+    m_pending = false;
+    return true;
+}
+
+void Oscilloscope::recordFrame(qint64 nanoseconds)
+{
+    m_frameNs[m_frames % StatisticsFrames] = nanoseconds;
+    m_frames++;
+}
+
+void Oscilloscope::resetStatistics()
+{
+    m_frames = 0;
+    m_dropped = 0;
+}
+
+double Oscilloscope::averageFrameMs() const
+{
+    const int frames = std::min(m_frames, StatisticsFrames);
+    if (frames == 0)
+        return 0.0;
+    qint64 total = 0;
+    for (int i = 0; i < frames; i++)
+        total += m_frameNs[i];
+    return total / 1e6 / frames;
+}
+
+double Oscilloscope::worstFrameMs() const
+{
+    const int frames = std::min(m_frames, StatisticsFrames);
+    return frames == 0 ? 0.0 : *std::max_element(m_frameNs, m_frameNs + frames) / 1e6;
+}
@@ -0,0 +1,74 @@
+// Oscilloscope.h
+#ifndef OSCILLOSCOPE_H
+#define OSCILLOSCOPE_H
+
+#include <QFuture>
+#include <QString>
+#include <QVector>
+#include "ExpressionEngine.h"
+#include "SampleBufferPool.h"
+#include "SegmentedCurve.h"
+
+// Animation of equations in x and t. Each frame the traces are evaluated on
+// the thread pool into the back one of a pair of curve buffers while the front
+// one is on screen, collect() then flips them. A front curve handed to a series
+// shares its points; by the time that buffer is written again the series has
+// moved on to the other one, so steady-state frames never reallocate.
+class Oscilloscope
+{
+public:
+    // Slot of t in function equations, right after x
+    static constexpr int TimeSlot = 1;
+    // Frames kept for the frame-time statistics
+    static constexpr int StatisticsFrames = 120;
+
+    struct Trace {
+        QString name;
+        CompiledExpression expression;
+        ExpressionBindings bindings;    // parameters, t is set per frame
+        SegmentedCurve curves[2];
+        PooledBuffer<double> ys;
+        int front = 0;
+
+        const SegmentedCurve &current() const { return curves[front]; }
+    };
+
+    ~Oscilloscope();
+
+    // Waits for a running frame before changing the traces
+    void clear();
+    void addTrace(const QString &name, const CompiledExpression &expression, const ExpressionBindings &bindings);
+    int traceCount() const { return int(m_traces.size()); }
+    const Trace &trace(int i) const { return m_traces[i]; }
+
+    // Start evaluating all traces at time t on the grid xMin + j * step
+    void submit(double time, double xMin, double step, int count, double yMin, double yMax, MathMode mode);
+
+    // Whether a submitted frame is still being evaluated
+    bool isBusy() const { return m_future.isRunning(); }
+
+    // Flip the buffers of a finished frame, false when there was none
+    bool collect();
+
+    // Time between presented frames and frames skipped because the worker was late
+    void recordFrame(qint64 nanoseconds);
+    void recordDropped() { m_dropped++; }
+    void resetStatistics();
+    double averageFrameMs() const;
+    double worstFrameMs() const;
+    qint64 droppedFrames() const { return m_dropped; }
+    double lastTime() const { return m_time; }
+
+private:
+    QVector<Trace> m_traces;
+    PooledBuffer<double> m_xs;
+    QFuture<void> m_future;
+    bool m_pending = false;
+    double m_time = 0.0;
+
+    qint64 m_frameNs[StatisticsFrames] = {};
+    int m_frames = 0;
+    qint64 m_dropped = 0;
+};
+
+#endif
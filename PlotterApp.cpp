@@ -1,15 +1,71 @@
 #include "PlotterApp.h"
+#include "Arena.h"
+#include "ExpressionJit.h"
+#include "PolylineStream.h"
+#include "StartupProfile.h"
 #include <QGridLayout>
 #include <QStackedWidget>
 #include <QSlider>
 #include <QtMath>
 #include <QMessageBox>
 #include <cmath>
+#include <limits>
+#include <algorithm>
+#include <memory>
 #include <QFileDialog>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPainterPath>
+#include <QPageSize>
+#include <QPdfWriter>
+#include <QSvgGenerator>
 #include <QApplication>
+#include <QScreen>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QJSEngine>
+#include <QLoggingCategory>
+
+// Per-equation diagnostics after each regeneration, enable with
+// QT_LOGGING_RULES="plotter.diagnostics.debug=true"
+Q_LOGGING_CATEGORY(lcDiagnostics, "plotter.diagnostics", QtInfoMsg)
+
+namespace {
+
+// Fixed styles of the main window's own widgets, applied as one sheet rather
+// than one per widget so it is parsed once and each widget is polished once
+const QString WindowStyleSheet = QStringLiteral(R"(
+    #titleBar, #contentWidget {
+        background-color: transparent;
+    }
+    #windowTitleLabel {
+        color: white;
+        font-weight: bold;
+        font-size: 14px;
+        background-color: transparent;
+    }
+    #closeWindowButton, #minimizeWindowButton {
+        color: white;
+        background-color: transparent;
+        border: none;
+        font-size: 18px;
+        font-weight: bold;
+    }
+    #closeWindowButton:hover {
+        background-color: #e81123;
+    }
+    #minimizeWindowButton:hover {
+        background-color: #333333;
+    }
+    #chartView, #chartView * {
+        background: transparent;
+    }
+)");
+
+} // namespace
 
 PlotterMainWindow::PlotterMainWindow(QWidget *parent)
     : QMainWindow(parent), m_resizing(false), m_dragging(false)
@@ -33,6 +89,7 @@ void PlotterMainWindow::setupUI()
 {
     // Set window title
     setWindowTitle("Function Plotter");
+    setStyleSheet(WindowStyleSheet);
 
     // Create central widget
     centralWidget = new QWidget(this);
@@ -49,7 +106,6 @@ void PlotterMainWindow::setupUI()
     // --- Start of Title Bar Area ---
     QWidget *titleBar = new QWidget(centralWidget);
     titleBar->setObjectName("titleBar");
-    titleBar->setStyleSheet("#titleBar { background-color: transparent; }");
     titleBar->setFixedHeight(40);
 
     QHBoxLayout *titleBarLayout = new QHBoxLayout(titleBar);
@@ -57,41 +113,18 @@ void PlotterMainWindow::setupUI()
 
     // Title label, Centered
     QLabel *titleLabel = new QLabel("Function Plotter", titleBar);
-    titleLabel->setStyleSheet("color: white; font-weight: bold; font-size: 14px; background-color: transparent;");
+    titleLabel->setObjectName("windowTitleLabel");
     titleLabel->setAlignment(Qt::AlignCenter);
 
     // Close button
     QPushButton *closeButton = new QPushButton("×", titleBar);
+    closeButton->setObjectName("closeWindowButton");
     closeButton->setFixedSize(30, 30);
-    closeButton->setStyleSheet(R"(
-        QPushButton {
-            color: white;
-            background-color: transparent;
-            border: none;
-            font-size: 18px;
-            font-weight: bold;
-        }
-        QPushButton:hover {
-            background-color: #e81123;
-        }
-    )");
-
 
     // Minimize button
     QPushButton *minimizeButton = new QPushButton("−", titleBar);
+    minimizeButton->setObjectName("minimizeWindowButton");
     minimizeButton->setFixedSize(30, 30);
-    minimizeButton->setStyleSheet(R"(
-        QPushButton {
-            color: white;
-            background-color: transparent;
-            border: none;
-            font-size: 18px;
-            font-weight: bold;
-        }
-        QPushButton:hover {
-            background-color: #333333;
-        }
-    )");
 
     // Adding titlebar components to titlebarlayout
     titleBarLayout->addStretch(1);
@@ -108,7 +141,6 @@ void PlotterMainWindow::setupUI()
     QWidget *contentWidget = new QWidget(centralWidget);
     contentWidget->setObjectName("contentWidget");
     // Transparent background to let the main window's paintEvent handle the background
-    contentWidget->setStyleSheet("#contentWidget { background-color: transparent; }");
 
     QHBoxLayout *contentLayout = new QHBoxLayout(contentWidget);
     contentLayout->setContentsMargins(8, 8, 8, 8);
@@ -128,9 +160,18 @@ void PlotterMainWindow::setupUI()
     QGroupBox *equationGroup = new QGroupBox("Equation (use 'x' as variable)");
     QVBoxLayout *equationLayout = new QVBoxLayout(equationGroup);
     equationInput = new QLineEdit();
-    equationInput->setPlaceholderText("Example: 2*x^2 + 3*sin(x)");
+    equationInput->setPlaceholderText("Example: 2*x^2 + 3*sin(x), other names become parameters");
     equationLayout->addWidget(equationInput);
 
+    // Plot type selection
+    plotTypeComboBox = new QComboBox();
+    plotTypeComboBox->addItem("Function y = f(x)");
+    plotTypeComboBox->addItem("Heatmap z = f(x, y)");
+    plotTypeComboBox->addItem("Differential equation y' = f(x, y)");
+    plotTypeComboBox->addItem("Iterated map x -> f(x, r)");
+    plotTypeComboBox->addItem("Complex w = f(z), z = x + iy");
+    equationLayout->addWidget(plotTypeComboBox);
+
     // Add and Remove buttons
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     addEquationButton = new QPushButton("Add Equation");
@@ -142,10 +183,24 @@ void PlotterMainWindow::setupUI()
     // Equations list
     QGroupBox *listGroup = new QGroupBox("Equations");
     QVBoxLayout *listLayout = new QVBoxLayout(listGroup);
-    equationsList = new QListWidget();
+    equationsList = new QListView();
+    equationsList->setModel(&plots);
+    equationsList->setUniformItemSizes(true);
+    equationsList->setEditTriggers(QAbstractItemView::NoEditTriggers);
     listLayout->addWidget(equationsList);
-    connect(equationsList, &QListWidget::itemDoubleClicked,
+    importEquationsButton = new QPushButton("Import Equations...");
+    listLayout->addWidget(importEquationsButton);
+    QHBoxLayout *sessionLayout = new QHBoxLayout();
+    openSessionButton = new QPushButton("Open Session...");
+    saveSessionButton = new QPushButton("Save Session...");
+    sessionLayout->addWidget(openSessionButton);
+    sessionLayout->addWidget(saveSessionButton);
+    listLayout->addLayout(sessionLayout);
+    connect(equationsList, &QListView::doubleClicked,
             this, &PlotterMainWindow::onEquationDoubleClicked);
+    connect(importEquationsButton, &QPushButton::clicked, this, &PlotterMainWindow::onImportEquationsClicked);
+    connect(openSessionButton, &QPushButton::clicked, this, &PlotterMainWindow::onOpenSessionClicked);
+    connect(saveSessionButton, &QPushButton::clicked, this, &PlotterMainWindow::onSaveSessionClicked);
 
     // Equation properties (visibility, color, line width)
     QGroupBox *propsGroup = new QGroupBox("Properties");
@@ -177,6 +232,22 @@ void PlotterMainWindow::setupUI()
     widthLayout->addWidget(lineWidthSpinBox);
     propsLayout->addLayout(widthLayout);
 
+    // Derivative curves, computed alongside f(x) by the compiled engine
+    QHBoxLayout *derivativeLayout = new QHBoxLayout();
+    derivativeCheckBox = new QCheckBox("Show f'(x)");
+    derivativeCheckBox->setEnabled(false);
+    secondDerivativeCheckBox = new QCheckBox("Show f''(x)");
+    secondDerivativeCheckBox->setEnabled(false);
+    derivativeLayout->addWidget(derivativeCheckBox);
+    derivativeLayout->addWidget(secondDerivativeCheckBox);
+    propsLayout->addLayout(derivativeLayout);
+
+    // Validation errors and sample counters of the selected equation
+    diagnosticsLabel = new QLabel();
+    diagnosticsLabel->setWordWrap(true);
+    diagnosticsLabel->setVisible(false);
+    propsLayout->addWidget(diagnosticsLabel);
+
     // Plot range controls
     QGroupBox *rangeGroup = new QGroupBox("Plot Range");
     QGridLayout *rangeLayout = new QGridLayout(rangeGroup);
@@ -207,10 +278,51 @@ void PlotterMainWindow::setupUI()
 
     rangeLayout->addWidget(new QLabel("Points:"), 2, 0);
     pointsSpinBox = new QSpinBox();
-    pointsSpinBox->setRange(10, 5000);
+    pointsSpinBox->setRange(10, 20000);
     pointsSpinBox->setValue(1000);
     rangeLayout->addWidget(pointsSpinBox, 2, 1);
 
+    // Cached sample precision and memory budget
+    rangeLayout->addWidget(new QLabel("Precision:"), 2, 2);
+    precisionComboBox = new QComboBox();
+    precisionComboBox->addItem("Double (8 B/sample)");
+    precisionComboBox->addItem("Float (4 B/sample)");
+    rangeLayout->addWidget(precisionComboBox, 2, 3);
+
+    rangeLayout->addWidget(new QLabel("Cache (MB):"), 3, 0);
+    cacheBudgetSpinBox = new QSpinBox();
+    cacheBudgetSpinBox->setRange(1, 65536);
+    cacheBudgetSpinBox->setValue(512);
+    rangeLayout->addWidget(cacheBudgetSpinBox, 3, 1);
+    cacheMemoryLabel = new QLabel("Sample cache: 0.0 MB");
+    rangeLayout->addWidget(cacheMemoryLabel, 3, 2, 1, 2);
+
+    // Polynomial sin/cos/exp/log while dragging sliders and panning heatmaps,
+    // Generate Plot and exports always use libm
+    fastMathCheckBox = new QCheckBox("Fast math for previews");
+    rangeLayout->addWidget(fastMathCheckBox, 4, 0, 1, 2);
+
+    // Native code tier for the sample loops, x86-64 only
+    jitCheckBox = new QCheckBox("Native code (JIT)");
+    jitCheckBox->setEnabled(ExpressionJit::isSupported());
+    if (!ExpressionJit::isSupported()) {
+        jitCheckBox->setToolTip("Not available on this platform, equations use the interpreter");
+    }
+    rangeLayout->addWidget(jitCheckBox, 5, 0, 1, 2);
+
+    // Point count from the plot width in device pixels
+    autoPointsCheckBox = new QCheckBox("Auto points");
+    autoPointsCheckBox->setToolTip("Sample each curve at the chart's pixel width times the oversampling");
+    rangeLayout->addWidget(autoPointsCheckBox, 6, 0, 1, 2);
+    rangeLayout->addWidget(new QLabel("Oversampling:"), 6, 2);
+    oversamplingSpinBox = new QDoubleSpinBox();
+    oversamplingSpinBox->setRange(0.25, 8.0);
+    oversamplingSpinBox->setSingleStep(0.25);
+    oversamplingSpinBox->setValue(2.0);
+    oversamplingSpinBox->setSuffix("x");
+    oversamplingSpinBox->setEnabled(false);
+    rangeLayout->addWidget(oversamplingSpinBox, 6, 3);
+
     // Plot appearance group
     QGroupBox *appearanceGroup = new QGroupBox("Plot Appearance");
     QGridLayout *appearanceLayout = new QGridLayout(appearanceGroup);
@@ -234,6 +346,10 @@ void PlotterMainWindow::setupUI()
     textColorButton->setMinimumWidth(60);
     appearanceLayout->addWidget(textColorButton, 1, 3);
 
+    // Draw curves in one chart item instead of a series each, for many equations
+    singleLayerCheckBox = new QCheckBox("Draw all curves in a single layer");
+    appearanceLayout->addWidget(singleLayerCheckBox, 2, 0, 1, 4);
+
     // Add the appearance group to the controls layout
     controlsLayout->addWidget(appearanceGroup);
 
@@ -246,17 +362,154 @@ void PlotterMainWindow::setupUI()
     // Save Plot as Image Button
     saveImageButton = new QPushButton("Save Plot as Image", controlsPanel);
 
+    // Heap allocations made while sampling, flat once buffers are warm
+    allocationLabel = new QLabel("Arena/pool allocations: 0");
+
+    // Analysis panel listing roots, extrema and intersections
+    QGroupBox *analysisGroup = new QGroupBox("Analysis");
+    QVBoxLayout *analysisLayout = new QVBoxLayout(analysisGroup);
+    findFeaturesButton = new QPushButton("Find Roots && Extrema");
+    featuresList = new QListWidget();
+    featuresList->setUniformItemSizes(true);
+    featuresList->setMaximumHeight(150);
+    analysisLayout->addWidget(findFeaturesButton);
+    analysisLayout->addWidget(featuresList);
+
+    // Sliders for the free parameters of the equations, one row per parameter
+    parametersGroup = new QGroupBox("Parameters");
+    QWidget *parametersWidget = new QWidget();
+    parametersGrid = new QGridLayout(parametersWidget);
+    parametersGrid->setContentsMargins(0, 0, 0, 0);
+    QVBoxLayout *parametersLayout = new QVBoxLayout(parametersGroup);
+    parametersLayout->addWidget(parametersWidget);
+    parametersGroup->setVisible(false);
+
+    // Parameter changes re-evaluate at most once per 60 Hz frame
+    parameterTimer = new QTimer(this);
+    parameterTimer->setSingleShot(true);
+    parameterTimer->setInterval(16);
+
+    // Parameter sweep drawing a whole family of one equation
+    QGroupBox *sweepGroup = new QGroupBox("Parameter Sweep");
+    QGridLayout *sweepLayout = new QGridLayout(sweepGroup);
+    sweepParameterComboBox = new QComboBox();
+    sweepFromSpinBox = new QDoubleSpinBox();
+    sweepFromSpinBox->setRange(-1000000, 1000000);
+    sweepFromSpinBox->setValue(0);
+    sweepToSpinBox = new QDoubleSpinBox();
+    sweepToSpinBox->setRange(-1000000, 1000000);
+    sweepToSpinBox->setValue(10);
+    sweepStepSpinBox = new QDoubleSpinBox();
+    sweepStepSpinBox->setRange(0.001, 1000000);
+    sweepStepSpinBox->setDecimals(3);
+    sweepStepSpinBox->setValue(0.1);
+    sweepButton = new QPushButton("Sweep Selected");
+    clearSweepButton = new QPushButton("Clear Sweep");
+    exportSweepButton = new QPushButton("Export Family...");
+    exportSweepButton->setEnabled(false);
+    sweepInfoLabel = new QLabel("No sweep");
+
+    sweepLayout->addWidget(new QLabel("Parameter:"), 0, 0);
+    sweepLayout->addWidget(sweepParameterComboBox, 0, 1, 1, 3);
+    sweepLayout->addWidget(new QLabel("From:"), 1, 0);
+    sweepLayout->addWidget(sweepFromSpinBox, 1, 1);
+    sweepLayout->addWidget(new QLabel("To:"), 1, 2);
+    sweepLayout->addWidget(sweepToSpinBox, 1, 3);
+    sweepLayout->addWidget(new QLabel("Step:"), 2, 0);
+    sweepLayout->addWidget(sweepStepSpinBox, 2, 1);
+    sweepLayout->addWidget(sweepButton, 2, 2, 1, 2);
+    sweepLayout->addWidget(clearSweepButton, 3, 0, 1, 2);
+    sweepLayout->addWidget(exportSweepButton, 3, 2, 1, 2);
+    sweepLayout->addWidget(sweepInfoLabel, 4, 0, 1, 4);
+
+    // Oscilloscope mode, t in function equations runs with the clock
+    QGroupBox *timeGroup = new QGroupBox("Time (t)");
+    QGridLayout *timeLayout = new QGridLayout(timeGroup);
+    runTimeButton = new QPushButton("Run");
+    runTimeButton->setCheckable(true);
+    resetTimeButton = new QPushButton("Reset t");
+    timeSpeedSpinBox = new QDoubleSpinBox();
+    timeSpeedSpinBox->setRange(0.01, 100.0);
+    timeSpeedSpinBox->setValue(1.0);
+    timeSpeedSpinBox->setSuffix("x");
+    timeInfoLabel = new QLabel("t = 0");
+    timeLayout->addWidget(runTimeButton, 0, 0);
+    timeLayout->addWidget(resetTimeButton, 0, 1);
+    timeLayout->addWidget(new QLabel("Speed:"), 0, 2);
+    timeLayout->addWidget(timeSpeedSpinBox, 0, 3);
+    timeLayout->addWidget(timeInfoLabel, 1, 0, 1, 4);
+
+    oscilloscopeTimer = new QTimer(this);
+    oscilloscopeTimer->setTimerType(Qt::PreciseTimer);
+    oscilloscopeTimer->setInterval(16);
+
+    // Differential equations, solved through initial values with adaptive steps
+    QGroupBox *odeGroup = new QGroupBox("Differential Equation y' = f(x, y)");
+    QGridLayout *odeLayout = new QGridLayout(odeGroup);
+    initialValuesInput = new QLineEdit("0, 1");
+    initialValuesInput->setPlaceholderText("x0, y0; x0, y0; ...");
+    initialValuesInput->setToolTip("Initial values of the new or selected equation, one solution each");
+    odeToleranceSpinBox = new QSpinBox();
+    odeToleranceSpinBox->setRange(2, 12);
+    odeToleranceSpinBox->setValue(6);
+    odeToleranceSpinBox->setPrefix("1e-");
+    directionFieldCheckBox = new QCheckBox("Direction field");
+    directionFieldCheckBox->setChecked(true);
+    odeInfoLabel = new QLabel("No solutions");
+    odeLayout->addWidget(new QLabel("Initial (x0, y0):"), 0, 0);
+    odeLayout->addWidget(initialValuesInput, 0, 1, 1, 3);
+    odeLayout->addWidget(new QLabel("Tolerance:"), 1, 0);
+    odeLayout->addWidget(odeToleranceSpinBox, 1, 1);
+    odeLayout->addWidget(directionFieldCheckBox, 1, 2, 1, 2);
+    odeLayout->addWidget(odeInfoLabel, 2, 0, 1, 4);
+
+    // Iterated maps, r runs along the x axis and the orbit's x values up the y axis
+    QGroupBox *mapGroup = new QGroupBox("Iterated Map x -> f(x, r)");
+    QGridLayout *mapLayout = new QGridLayout(mapGroup);
+    mapStartSpinBox = new QDoubleSpinBox();
+    mapStartSpinBox->setRange(-1000, 1000);
+    mapStartSpinBox->setDecimals(4);
+    mapStartSpinBox->setValue(0.5);
+    mapTransientSpinBox = new QSpinBox();
+    mapTransientSpinBox->setRange(0, 100000);
+    mapTransientSpinBox->setValue(500);
+    mapIterationsSpinBox = new QSpinBox();
+    mapIterationsSpinBox->setRange(1, 100000);
+    mapIterationsSpinBox->setValue(1000);
+    mapSamplesSpinBox = new QSpinBox();
+    mapSamplesSpinBox->setRange(1, 64);
+    mapSamplesSpinBox->setValue(4);
+    mapInfoLabel = new QLabel("No map");
+    mapLayout->addWidget(new QLabel("x0:"), 0, 0);
+    mapLayout->addWidget(mapStartSpinBox, 0, 1);
+    mapLayout->addWidget(new QLabel("r per pixel:"), 0, 2);
+    mapLayout->addWidget(mapSamplesSpinBox, 0, 3);
+    mapLayout->addWidget(new QLabel("Transient:"), 1, 0);
+    mapLayout->addWidget(mapTransientSpinBox, 1, 1);
+    mapLayout->addWidget(new QLabel("Iterations:"), 1, 2);
+    mapLayout->addWidget(mapIterationsSpinBox, 1, 3);
+    mapLayout->addWidget(mapInfoLabel, 2, 0, 1, 4);
+
     // Add all controls to the left panel
     controlsLayout->addWidget(nameGroup);
     controlsLayout->addWidget(equationGroup);
     controlsLayout->addLayout(buttonLayout);
     controlsLayout->addWidget(listGroup);
     controlsLayout->addWidget(propsGroup);
+    controlsLayout->addWidget(parametersGroup);
+    controlsLayout->addWidget(sweepGroup);
+    controlsLayout->addWidget(timeGroup);
+    controlsLayout->addWidget(odeGroup);
+    controlsLayout->addWidget(mapGroup);
     controlsLayout->addWidget(rangeGroup);
     controlsLayout->addLayout(plotButtonsLayout);
     controlsLayout->addWidget(saveImageButton);
+    controlsLayout->addWidget(allocationLabel);
+    controlsLayout->addWidget(analysisGroup);
     controlsLayout->addStretch();
 
+    StartupProfile::mark("controls");
+
     // Create the chart view
     chart = new QChart();
     chart->setTitle("Function Plot");
@@ -287,19 +540,53 @@ void PlotterMainWindow::setupUI()
     // Set legend text color
     chart->legend()->setLabelBrush(QBrush(QColor(255, 255, 255)));
 
+    // Image layer for heatmaps, drawn under the grid and series
+    heatmapLayer = new ChartImageLayer(chart);
+
+    // Image layer for swept curve families, stacked above the heatmap
+    sweepLayer = new ChartImageLayer(chart);
+
+    // Image layer for bifurcation diagrams of iterated maps
+    mapLayer = new ChartImageLayer(chart);
+
+    // Layer drawing function curves when single-layer rendering is on
+    curveLayer = new CurveLayer(chart);
+
+    // Crosshair and value readout under the cursor
+    crosshairLayer = new CrosshairLayer(chart);
+
     chartView = new QChartView(chart);
     chartView->setRenderHint(QPainter::Antialiasing);
     chartView->setMinimumWidth(600);
 
     // Make the chart background transparent
-    chartView->setStyleSheet("background: transparent;");
+    chartView->setObjectName("chartView");
+
+    // Hover events drive the crosshair
+    chartView->viewport()->setMouseTracking(true);
+    chartView->viewport()->installEventFilter(this);
+
+    // Scaled snapshot of the chart shown while the window is resized or dragged,
+    // the chart itself is re-laid out once when the interaction ends
+    chartSnapshot = new QLabel();
+    chartSnapshot->setScaledContents(true);
+    chartSnapshot->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+    chartStack = new QStackedWidget();
+    chartStack->addWidget(chartView);
+    chartStack->addWidget(chartSnapshot);
+
+    // Window geometry changes are applied at most once per display frame
+    geometryTimer = new QTimer(this);
+    geometryTimer->setSingleShot(true);
+    connect(geometryTimer, &QTimer::timeout, this, &PlotterMainWindow::applyPendingGeometry);
 
     // Add widgets to content layout
     contentLayout->addWidget(controlsPanel, 1);
-    contentLayout->addWidget(chartView, 3);
+    contentLayout->addWidget(chartStack, 3);
 
     // Add content area to main layout
     mainLayout->addWidget(contentWidget, 1);
+    StartupProfile::mark("chart");
 
     // Connect signals
     connect(closeButton, &QPushButton::clicked, this, &QMainWindow::close);
@@ -308,11 +595,70 @@ void PlotterMainWindow::setupUI()
     connect(removeEquationButton, &QPushButton::clicked, this, &PlotterMainWindow::onRemoveEquationClicked);
     connect(generatePlotButton, &QPushButton::clicked, this, &PlotterMainWindow::onGeneratePlotClicked);
     connect(clearPlotButton, &QPushButton::clicked, this, &PlotterMainWindow::onClearPlotClicked);
-    connect(equationsList, &QListWidget::currentRowChanged, this, &PlotterMainWindow::onEquationSelectionChanged);
+    connect(equationsList->selectionModel(), &QItemSelectionModel::currentRowChanged,
+            this, &PlotterMainWindow::onEquationSelectionChanged);
     connect(visibilityCheckBox, &QCheckBox::stateChanged, this, &PlotterMainWindow::onEquationVisibilityChanged);
     connect(colorButton, &QPushButton::clicked, this, &PlotterMainWindow::onEquationColorChanged);
     connect(lineWidthSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &PlotterMainWindow::onLineWidthChanged);
+    connect(derivativeCheckBox, &QCheckBox::toggled, this, &PlotterMainWindow::onDerivativeOptionsChanged);
+    connect(secondDerivativeCheckBox, &QCheckBox::toggled, this, &PlotterMainWindow::onDerivativeOptionsChanged);
     connect(saveImageButton, &QPushButton::clicked, this, &PlotterMainWindow::onSavePlotAsImageClicked);
+    connect(findFeaturesButton, &QPushButton::clicked, this, &PlotterMainWindow::onFindFeaturesClicked);
+    connect(parameterTimer, &QTimer::timeout, this, &PlotterMainWindow::onParameterFrame);
+    connect(cacheBudgetSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &PlotterMainWindow::enforceCacheBudget);
+    connect(chart, &QChart::plotAreaChanged, this, &PlotterMainWindow::updateHeatmapLayer);
+    connect(axisX, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateHeatmapLayer);
+    connect(axisY, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateHeatmapLayer);
+    connect(chart, &QChart::plotAreaChanged, this, &PlotterMainWindow::updateSweepLayer);
+    connect(axisX, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateSweepLayer);
+    connect(axisY, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateSweepLayer);
+    connect(chart, &QChart::plotAreaChanged, this, &PlotterMainWindow::updateMapLayer);
+    connect(axisX, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateMapLayer);
+    connect(axisY, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateMapLayer);
+    connect(chart, &QChart::plotAreaChanged, this, &PlotterMainWindow::updateCurveLayer);
+    connect(axisX, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateCurveLayer);
+    connect(axisY, &QValueAxis::rangeChanged, this, &PlotterMainWindow::updateCurveLayer);
+    connect(singleLayerCheckBox, &QCheckBox::toggled, this, [this]() {
+        if (!plots.isEmpty()) {
+            onGeneratePlotClicked();
+        }
+    });
+    connect(fastMathCheckBox, &QCheckBox::toggled, this, &PlotterMainWindow::refinePreviews);
+    connect(jitCheckBox, &QCheckBox::toggled, this, [](bool checked) {
+        ExpressionJit::setEnabled(checked);
+    });
+    connect(autoPointsCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        pointsSpinBox->setEnabled(!checked);
+        oversamplingSpinBox->setEnabled(checked);
+        updateAutoPoints(true);
+    });
+    connect(oversamplingSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this]() {
+        updateAutoPoints(true);
+    });
+    connect(chart, &QChart::plotAreaChanged, this, [this]() {
+        updateAutoPoints(false);
+    });
+    connect(sweepButton, &QPushButton::clicked, this, &PlotterMainWindow::onSweepClicked);
+    connect(runTimeButton, &QPushButton::toggled, this, &PlotterMainWindow::onRunTimeToggled);
+    connect(resetTimeButton, &QPushButton::clicked, this, &PlotterMainWindow::onResetTimeClicked);
+    connect(oscilloscopeTimer, &QTimer::timeout, this, &PlotterMainWindow::onOscilloscopeFrame);
+    connect(initialValuesInput, &QLineEdit::editingFinished, this, &PlotterMainWindow::onInitialValuesEdited);
+    connect(odeToleranceSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &PlotterMainWindow::onOdeOptionsChanged);
+    connect(directionFieldCheckBox, &QCheckBox::toggled, this, &PlotterMainWindow::onOdeOptionsChanged);
+    // Without keyboard tracking the map iterates once a typed value is committed, not per keystroke
+    mapStartSpinBox->setKeyboardTracking(false);
+    connect(mapStartSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &PlotterMainWindow::updateMapLayer);
+    for (QSpinBox *spinBox : { mapTransientSpinBox, mapIterationsSpinBox, mapSamplesSpinBox }) {
+        spinBox->setKeyboardTracking(false);
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &PlotterMainWindow::updateMapLayer);
+    }
+    connect(timeSpeedSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this]() {
+        // Keep t continuous, the new speed applies from now on
+        m_timeOrigin = m_time;
+        m_timeClock.restart();
+    });
+    connect(clearSweepButton, &QPushButton::clicked, this, &PlotterMainWindow::onClearSweepClicked);
+    connect(exportSweepButton, &QPushButton::clicked, this, &PlotterMainWindow::onExportSweepClicked);
     connect(bgColorButton, &QPushButton::clicked, [this]() {
         // Get current background color
         QColor currentColor = chart->isBackgroundVisible() ?
@@ -322,13 +668,7 @@ void PlotterMainWindow::setupUI()
                                                  "Select Chart Background Color");
 
         if (newColor.isValid()) {
-            // Update background color
-            chart->setBackgroundVisible(true);
-            chart->setBackgroundBrush(QBrush(newColor));
-
-            // Update button appearance
-            QString colorStyle = QString("background-color: %1").arg(newColor.name());
-            bgColorButton->setStyleSheet(colorStyle);
+            applyBackgroundColor(newColor);
         }
     });
     connect(textColorButton, &QPushButton::clicked, [this]() {
@@ -339,25 +679,43 @@ void PlotterMainWindow::setupUI()
                                                  "Select Chart Text Color");
 
         if (newColor.isValid()) {
-            // Update text colors
-            chart->setTitleBrush(QBrush(newColor));
+            applyTextColor(newColor);
+        }
+    });
+    StartupProfile::mark("connections");
+}
+
+void PlotterMainWindow::applyBackgroundColor(const QColor &color)
+{
+    chart->setBackgroundVisible(true);
+    chart->setBackgroundBrush(QBrush(color));
 
-            // Update axis labels color
-            axisX->setLabelsBrush(QBrush(newColor));
-            axisY->setLabelsBrush(QBrush(newColor));
+    // Update button appearance
+    QString colorStyle = QString("background-color: %1").arg(color.name());
+    bgColorButton->setStyleSheet(colorStyle);
+}
 
-            // Update axis titles color
-            axisX->setTitleBrush(QBrush(newColor));
-            axisY->setTitleBrush(QBrush(newColor));
+void PlotterMainWindow::applyTextColor(const QColor &color)
+{
+    // Update text colors
+    chart->setTitleBrush(QBrush(color));
 
-            // Update legend text color
-            chart->legend()->setLabelBrush(QBrush(newColor));
+    // Update axis labels color
+    axisX->setLabelsBrush(QBrush(color));
+    axisY->setLabelsBrush(QBrush(color));
 
-            // Update button appearance
-            QString colorStyle = QString("background-color: %1").arg(newColor.name());
-            textColorButton->setStyleSheet(colorStyle);
-        }
-    });
+    // Update axis titles color
+    axisX->setTitleBrush(QBrush(color));
+    axisY->setTitleBrush(QBrush(color));
+
+    // Update legend text color
+    chart->legend()->setLabelBrush(QBrush(color));
+    curveLayer->setLegendColor(color);
+    crosshairLayer->setColor(color);
+
+    // Update button appearance
+    QString colorStyle = QString("background-color: %1").arg(color.name());
+    textColorButton->setStyleSheet(colorStyle);
 }
 
 // Note, this paintEvent is key to getting the rounded corners and custom border
@@ -390,6 +748,11 @@ void PlotterMainWindow::paintEvent(QPaintEvent *event)
 
     // Draw the rounded rectangle
     painter.drawPath(path);
+
+    // The children paint in the same pass, the frame is complete once control returns to the event loop
+    if (StartupProfile::isEnabled()) {
+        QTimer::singleShot(0, &StartupProfile::finish);
+    }
 }
 
 // Window frame drag handling
@@ -399,6 +762,7 @@ void PlotterMainWindow::mousePressEvent(QMouseEvent *event)
     if (event->position().y() <= 40) {
         m_dragging = true;
         m_dragPosition = event->globalPosition().toPoint() - frameGeometry().topLeft();
+        beginInteraction();
         event->accept();
         return;
     }
@@ -471,6 +835,7 @@ void PlotterMainWindow::mousePressEvent(QMouseEvent *event)
         if (m_resizing) {
             m_resizeStartPos = event->globalPosition().toPoint();
             m_initialRect = rect();
+            beginInteraction();
             event->accept();
         }
     }
@@ -479,14 +844,17 @@ void PlotterMainWindow::mousePressEvent(QMouseEvent *event)
 void PlotterMainWindow::mouseMoveEvent(QMouseEvent *event)
 {
     if (m_dragging) {
-        move(event->globalPosition().toPoint() - m_dragPosition);
+        m_pendingGeometry.moveTopLeft(event->globalPosition().toPoint() - m_dragPosition);
+        scheduleGeometry();
         event->accept();
         return;
     }
 
     if (m_resizing) {
         QPoint globalPos = event->globalPosition().toPoint();
-        QRect currentGeometry = geometry();
+
+        // Start from the latest requested geometry, the applied one lags behind
+        QRect currentGeometry = m_pendingGeometry;
 
         // Handle resize based on mode
         switch (m_resizeMode) {
@@ -582,8 +950,9 @@ void PlotterMainWindow::mouseMoveEvent(QMouseEvent *event)
             }
         }
 
-        // Apply the new geometry
-        setGeometry(currentGeometry);
+        // Apply the new geometry on the next frame
+        m_pendingGeometry = currentGeometry;
+        scheduleGeometry();
         event->accept();
         return;
     }
@@ -615,14 +984,69 @@ void PlotterMainWindow::mouseMoveEvent(QMouseEvent *event)
     }
 }
 
+bool PlotterMainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == chartView->viewport()) {
+        if (event->type() == QEvent::MouseMove) {
+            updateCrosshair(static_cast<QMouseEvent *>(event)->position().toPoint());
+        } else if (event->type() == QEvent::Leave) {
+            crosshairLayer->hideCursor();
+        }
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
 void PlotterMainWindow::mouseReleaseEvent(QMouseEvent *event)
 {
+    if (m_dragging || m_resizing) {
+        endInteraction();
+    }
     m_dragging = false;
     m_resizing = false;
     setCursor(Qt::ArrowCursor);
     event->accept();
 }
 
+void PlotterMainWindow::beginInteraction()
+{
+    m_pendingGeometry = geometry();
+
+    // One frame per display refresh, 60 Hz when the screen doesn't say
+    const qreal refreshRate = screen() ? screen()->refreshRate() : 60.0;
+    geometryTimer->setInterval(qMax(1, qRound(1000.0 / (refreshRate > 0.0 ? refreshRate : 60.0))));
+
+    // Swap the chart for a snapshot so resizing only scales a pixmap instead
+    // of re-laying out and repainting every antialiased series
+    chartSnapshot->setPixmap(chartView->grab());
+    chartStack->setCurrentWidget(chartSnapshot);
+}
+
+void PlotterMainWindow::scheduleGeometry()
+{
+    if (!geometryTimer->isActive()) {
+        geometryTimer->start();
+    }
+}
+
+void PlotterMainWindow::applyPendingGeometry()
+{
+    if (m_dragging) {
+        move(m_pendingGeometry.topLeft());
+    } else if (m_resizing) {
+        setGeometry(m_pendingGeometry);
+    }
+}
+
+void PlotterMainWindow::endInteraction()
+{
+    // Flush the last coalesced move, then render the chart once at the final size
+    geometryTimer->stop();
+    applyPendingGeometry();
+    chartView->setGeometry(chartSnapshot->geometry());
+    chartStack->setCurrentWidget(chartView);
+    chartSnapshot->clear();
+}
+
 void PlotterMainWindow::onAddEquationClicked()
 {
     QString name = equationNameInput->text().trimmed();
@@ -640,11 +1064,9 @@ void PlotterMainWindow::onAddEquationClicked()
     }
 
     // Check for duplicate names
-    for (const EquationPlot &plot : plots) {
-        if (plot.name == name) {
-            QMessageBox::warning(this, "Duplicate Name", "An equation with this name already exists.");
-            return;
-        }
+    if (plots.contains(name)) {
+        QMessageBox::warning(this, "Duplicate Name", "An equation with this name already exists.");
+        return;
     }
 
     // Create a new equation
@@ -652,9 +1074,40 @@ void PlotterMainWindow::onAddEquationClicked()
     newPlot.name = name;
     newPlot.equation = equation;
     newPlot.lineWidth = lineWidthSpinBox->value();
+    newPlot.type = static_cast<PlotType>(plotTypeComboBox->currentIndex());
+
+    QString error;
+    if (!validateEquation(newPlot, &error)) {
+        QMessageBox::warning(this, "Invalid Equation", error);
+        return;
+    }
+
+    if (newPlot.type == PlotType::Ode) {
+        newPlot.initialValues = OdeSolver::parseInitialValues(initialValuesInput->text(), &error);
+        if (newPlot.initialValues.isEmpty()) {
+            QMessageBox::warning(this, "Invalid Initial Values", error);
+            return;
+        }
+    }
 
     // Assign a color from a predefined list
-    QList<QColor> colors = {
+    newPlot.color = defaultColor(plots.size());
+
+    // Add to the model, the list view follows it
+    plots.append(newPlot);
+    syncParameters();
+
+    // Select the new equation
+    selectEquation(plots.size() - 1);
+
+    // Clear inputs
+    equationNameInput->clear();
+    equationInput->clear();
+}
+
+QColor PlotterMainWindow::defaultColor(int index)
+{
+    static const QList<QColor> colors = {
         QColor(255, 0, 0),     // Red
         QColor(0, 0, 255),     // Blue
         QColor(0, 128, 0),     // Green
@@ -664,28 +1117,218 @@ void PlotterMainWindow::onAddEquationClicked()
         QColor(255, 0, 255),   // Magenta
         QColor(128, 128, 0)    // Olive
     };
+    return colors[index % colors.size()];
+}
 
-    newPlot.color = colors[plots.size() % colors.size()];
+int PlotterMainWindow::currentEquationRow() const
+{
+    const QModelIndex current = equationsList->currentIndex();
+    return current.isValid() ? current.row() : -1;
+}
 
-    // Add to lists
-    plots.append(newPlot);
-    equationsList->addItem(name);
+void PlotterMainWindow::selectEquation(int row)
+{
+    equationsList->setCurrentIndex(plots.index(row));
+}
 
-    // Select the new equation
-    equationsList->setCurrentRow(plots.size() - 1);
+void PlotterMainWindow::onImportEquationsClicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Import Equations", "",
+                                                    "Equation Files (*.txt *.eq);;All Files (*)");
+    if (fileName.isEmpty()) {
+        return;
+    }
 
-    // Clear inputs
-    equationNameInput->clear();
-    equationInput->clear();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Import Error", "Failed to open the equation file.");
+        return;
+    }
+
+    // One equation per line as "name = equation" or just "equation", '#' starts a comment
+    struct ImportLine {
+        int number;
+        QString text;
+        EquationPlot plot;
+        QString error;
+    };
+    QList<ImportLine> lines;
+    int number = 0;
+    while (!file.atEnd()) {
+        const QString text = QString::fromUtf8(file.readLine()).trimmed();
+        number++;
+        if (!text.isEmpty() && !text.startsWith('#')) {
+            lines.append({ number, text, EquationPlot(), QString() });
+        }
+    }
+
+    // Parse and compile every line in parallel, only the name checks below are serial
+    const double lineWidth = lineWidthSpinBox->value();
+    QtConcurrent::blockingMap(lines, [lineWidth](ImportLine &line) {
+        const int separator = line.text.indexOf('=');
+        line.plot.name = separator > 0 ? line.text.left(separator).trimmed() : QString();
+        line.plot.equation = separator > 0 ? line.text.mid(separator + 1).trimmed() : line.text;
+        line.plot.lineWidth = lineWidth;
+        if (line.plot.equation.isEmpty()) {
+            line.error = "empty equation";
+        } else if (!compileEquation(line.plot, &line.error)) {
+            line.error = line.error.isEmpty() ? "cannot compile" : line.error;
+        }
+    });
+
+    QList<EquationPlot> accepted;
+    QSet<QString> names;
+    QStringList rejected;
+    accepted.reserve(lines.size());
+    for (ImportLine &line : lines) {
+        EquationPlot &plot = line.plot;
+        if (line.error.isEmpty() && plot.name.isEmpty()) {
+            // Unnamed equations get the first free "f<row>" name
+            int suffix = plots.size() + accepted.size() + 1;
+            do {
+                plot.name = QString("f%1").arg(suffix++);
+            } while (plots.contains(plot.name) || names.contains(plot.name));
+        }
+        if (line.error.isEmpty() && (plots.contains(plot.name) || names.contains(plot.name))) {
+            line.error = "duplicate name '" + plot.name + "'";
+        }
+        if (!line.error.isEmpty()) {
+            rejected.append(QString("Line %1: %2").arg(line.number).arg(line.error));
+            continue;
+        }
+
+        plot.color = defaultColor(plots.size() + accepted.size());
+        names.insert(plot.name);
+        accepted.append(plot);
+    }
+
+    // One model insertion for the whole batch
+    const bool wasEmpty = plots.isEmpty();
+    plots.append(accepted);
+    syncParameters();
+    if (wasEmpty && !plots.isEmpty()) {
+        selectEquation(0);
+    }
+
+    if (!rejected.isEmpty()) {
+        QMessageBox::warning(this, "Import",
+                             QString("Imported %1 equations, skipped %2:\n").arg(accepted.size()).arg(rejected.size()) +
+                                 rejected.mid(0, 20).join("\n"));
+    }
+}
+
+void PlotterMainWindow::onSaveSessionClicked()
+{
+    const QString withSamples = "Session with cached samples (*.eqs)";
+    const QString compressed = "Session with compressed samples (*.eqs)";
+    QString filter;
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Session", "",
+                                                    "Session (*.eqs);;" + withSamples + ";;" + compressed, &filter);
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (QFileInfo(fileName).suffix().isEmpty()) {
+        fileName += ".eqs";
+    }
+
+    SessionSettings settings;
+    settings.title = plotTitleInput->text();
+    settings.background = chart->isBackgroundVisible() ? chart->backgroundBrush().color() : QColor();
+    settings.text = chart->titleBrush().color();
+    settings.xMin = xMinSpinBox->value();
+    settings.xMax = xMaxSpinBox->value();
+    settings.yMin = yMinSpinBox->value();
+    settings.yMax = yMaxSpinBox->value();
+    settings.points = pointsSpinBox->value();
+    settings.autoPoints = autoPointsCheckBox->isChecked();
+    settings.oversampling = oversamplingSpinBox->value();
+    settings.precision = static_cast<SamplePrecision>(precisionComboBox->currentIndex());
+    settings.time = m_time;
+    for (const PlotParameter &parameter : parameters) {
+        settings.parameters.append({ parameter.name, parameter.value });
+    }
+
+    const SessionFile::Samples samples = filter == withSamples ? SessionFile::Samples::Raw
+                                         : filter == compressed ? SessionFile::Samples::Compressed
+                                                                : SessionFile::Samples::None;
+    QString error;
+    if (!SessionFile::save(fileName, settings, plots, samples, &error)) {
+        QMessageBox::warning(this, "Save Error", "Failed to save the session: " + error);
+    }
+}
+
+void PlotterMainWindow::onOpenSessionClicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Open Session", "",
+                                                    "Session (*.eqs);;All Files (*)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    SessionSettings settings;
+    QList<EquationPlot> loaded;
+    QString error;
+    if (!SessionFile::load(fileName, settings, loaded, &error)) {
+        QMessageBox::warning(this, "Open Error", "Failed to open the session: " + error);
+        return;
+    }
+
+    // Compile in parallel like an import, restored samples stay in their caches
+    QtConcurrent::blockingMap(loaded, [](EquationPlot &plot) {
+        compileEquation(plot);
+    });
+
+    // The session replaces the current one
+    onClearPlotClicked();
+    plots.clear();
+
+    plotTitleInput->setText(settings.title);
+    if (settings.background.isValid()) {
+        applyBackgroundColor(settings.background);
+    }
+    if (settings.text.isValid()) {
+        applyTextColor(settings.text);
+    }
+    {
+        // Sampling settings must match the saved ones for the caches to be reused,
+        // the plot below regenerates once with all of them in place
+        QSignalBlocker autoBlocker(autoPointsCheckBox);
+        QSignalBlocker oversamplingBlocker(oversamplingSpinBox);
+        xMinSpinBox->setValue(settings.xMin);
+        xMaxSpinBox->setValue(settings.xMax);
+        yMinSpinBox->setValue(settings.yMin);
+        yMaxSpinBox->setValue(settings.yMax);
+        pointsSpinBox->setValue(settings.points);
+        autoPointsCheckBox->setChecked(settings.autoPoints);
+        pointsSpinBox->setEnabled(!settings.autoPoints);
+        oversamplingSpinBox->setValue(settings.oversampling);
+        oversamplingSpinBox->setEnabled(settings.autoPoints);
+        precisionComboBox->setCurrentIndex(int(settings.precision));
+    }
+    m_time = settings.time;
+    m_timeOrigin = settings.time;
+
+    parameters.clear();
+    for (const auto &parameter : settings.parameters) {
+        parameters.append({ parameter.first, parameter.second });
+    }
+
+    plots.append(loaded);
+    syncParameters();
+    if (!plots.isEmpty()) {
+        selectEquation(0);
+        onGeneratePlotClicked();
+    }
 }
 
 void PlotterMainWindow::onRemoveEquationClicked()
 {
-    int currentRow = equationsList->currentRow();
+    int currentRow = currentEquationRow();
     if (currentRow >= 0 && currentRow < plots.size()) {
         // Remove the plot
-        delete equationsList->takeItem(currentRow);
+        removeSeriesOf(plots[currentRow]);
         plots.removeAt(currentRow);
+        syncParameters();
 
         // Update controls
         if (plots.isEmpty()) {
@@ -693,12 +1336,14 @@ void PlotterMainWindow::onRemoveEquationClicked()
             visibilityCheckBox->setEnabled(false);
             colorButton->setEnabled(false);
             lineWidthSpinBox->setEnabled(false);
+            derivativeCheckBox->setEnabled(false);
+            secondDerivativeCheckBox->setEnabled(false);
         } else {
             // Select another equation
             if (currentRow >= plots.size()) {
-                equationsList->setCurrentRow(plots.size() - 1);
+                selectEquation(plots.size() - 1);
             } else {
-                equationsList->setCurrentRow(currentRow);
+                selectEquation(currentRow);
             }
         }
 
@@ -721,8 +1366,10 @@ void PlotterMainWindow::onGeneratePlotClicked()
         return;
     }
 
-    // Remove all existing series
-    chart->removeAllSeries();
+    // Existing series are kept and refilled, only markers are rebuilt
+    clearFeatures();
+    m_heatmapIndex = -1;
+    m_mapIndex = -1;
 
     // Get plot ranges
     double xMin = xMinSpinBox->value();
@@ -749,174 +1396,1428 @@ void PlotterMainWindow::onGeneratePlotClicked()
     int numPoints = pointsSpinBox->value();
     double step = (xMax - xMin) / (numPoints - 1);
 
-    // Generate each plot
-    for (int i = 0; i < plots.size(); i++) {
-        EquationPlot &plot = plots[i];
-
-        // Skip if not visible
-        if (!plot.visible) continue;
-
-        // Create a new series
-        QLineSeries *series = new QLineSeries();
-        series->setName(plot.name);
-        series->setColor(plot.color);
-        series->setPen(QPen(plot.color, plot.lineWidth));
+    const quint64 allocationsBefore = HotPathAllocations::count();
+    const SamplePrecision precision = static_cast<SamplePrecision>(precisionComboBox->currentIndex());
+    m_generation++;
 
-        // Store the series for later updates
-        plot.series = series;
-
-        // Generate points
-        bool validPoints = false;
-        for (int j = 0; j < numPoints; j++) {
-            double x = xMin + j * step;
+    prepareSampleGrid(xMin, step, numPoints);
 
-            try {
-                double y = evaluateExpression(plot.equation, x);
+    // Generate each plot, failures are reported together afterwards
+    QStringList failures;
+    for (int i = 0; i < plots.size(); i++) {
+        EquationPlot &plot = plots[i];
 
-                // Only add valid points within y-range
-                if (std::isfinite(y) && y >= yMin && y <= yMax) {
-                    series->append(x, y);
-                    validPoints = true;
+        // Skip if not visible, heatmaps and maps have no line series either.
+        // Hidden equations keep their samples until the cache budget evicts them.
+        if (!plot.visible || plot.type == PlotType::Heatmap || plot.type == PlotType::Complex ||
+            plot.type == PlotType::IteratedMap) {
+            removeSeriesOf(plot);
+
+            // Heatmaps and complex functions are drawn by the image layer, the topmost visible one wins.
+            // The same goes for iterated maps.
+            if (plot.type == PlotType::Heatmap || plot.type == PlotType::Complex) {
+                plot.samples.clear();
+                if (plot.visible && m_heatmapIndex < 0) {
+                    m_heatmapIndex = i;
                 }
-            } catch (...) {
-                // Skip errors and continue with other points
             }
+            if (plot.type == PlotType::IteratedMap && plot.visible && m_mapIndex < 0) {
+                m_mapIndex = i;
+            }
+            continue;
         }
 
-        // Add the series to the chart if it has valid points
-        if (validPoints) {
-            chart->addSeries(series);
-            series->attachAxis(axisX);
-            series->attachAxis(axisY);
-        } else {
-            delete series;
-            plot.series = nullptr;
-            QMessageBox::warning(this, "Plot Error",
-                                 "No valid points found for equation '" + plot.name +
-                                     "'. Check your equation and axis ranges.");
+        plot.lastVisible = m_generation;
+        if (plot.type == PlotType::Ode) {
+            generateOdePlot(plot, xMin, xMax, yMin, yMax, step);
+            continue;
+        }
+        if (!generateFunctionPlot(plot, xMin, step, numPoints, yMin, yMax, precision, MathMode::Exact)) {
+            const EquationDiagnostics &diagnostics = plot.diagnostics;
+            const QString &error = diagnostics.evaluationError.isEmpty() ? diagnostics.compileError
+                                                                         : diagnostics.evaluationError;
+            failures.append(plot.name + ": " + (error.isEmpty() ? QString("no valid points in the axis ranges") : error));
         }
     }
-}
 
-void PlotterMainWindow::onClearPlotClicked()
-{
-    chart->removeAllSeries();
 
-    // Reset the series pointers
-    for (EquationPlot &plot : plots) {
-        plot.series = nullptr;
+    // One line per plotted equation when tracing is on, none from the sample loops
+    if (lcDiagnostics().isDebugEnabled()) {
+        for (const EquationPlot &plot : plots) {
+            if (plot.lastVisible == m_generation) {
+                qCDebug(lcDiagnostics).noquote() << plot.name + ":" << plot.diagnostics.summary().replace('\n', "; ");
+            }
+        }
     }
-}
-
-void PlotterMainWindow::onEquationSelectionChanged()
-{
-    int currentRow = equationsList->currentRow();
-    bool hasSelection = (currentRow >= 0 && currentRow < plots.size());
+    updateDiagnosticsLabel();
 
-    // Enable/disable buttons based on selection
-    removeEquationButton->setEnabled(hasSelection);
-    visibilityCheckBox->setEnabled(hasSelection);
-    colorButton->setEnabled(hasSelection);
-    lineWidthSpinBox->setEnabled(hasSelection);
+    enforceCacheBudget();
 
-    // Update controls based on selection
-    if (hasSelection) {
-        EquationPlot &plot = plots[currentRow];
+    const quint64 allocations = HotPathAllocations::count();
+    allocationLabel->setText(QString("Arena/pool allocations: %1 (last regeneration: %2)")
+                                 .arg(allocations).arg(allocations - allocationsBefore));
 
-        // Update visibility checkbox
-        visibilityCheckBox->setChecked(plot.visible);
+    updateCurveLayer();
+    updateHeatmapLayer();
+    updateMapLayer();
 
-        // Update color button
-        QString colorStyle = QString("background-color: %1").arg(plot.color.name());
-        colorButton->setStyleSheet(colorStyle);
+    if (oscilloscopeTimer->isActive()) {
+        startOscilloscope();
+    }
 
-        // Update line width
-        lineWidthSpinBox->setValue(plot.lineWidth);
+    // One dialog however many equations failed, e.g. after importing a bad batch
+    if (!failures.isEmpty()) {
+        constexpr int MaxListed = 20;
+        QString message = QString("%1 equations could not be plotted:\n").arg(failures.size()) +
+                          failures.mid(0, MaxListed).join("\n");
+        if (failures.size() > MaxListed) {
+            message += QString("\n... and %1 more").arg(failures.size() - MaxListed);
+        }
+        QMessageBox::warning(this, "Plot Error", message);
     }
 }
 
-void PlotterMainWindow::onEquationVisibilityChanged(int state)
+int PlotterMainWindow::autoPointCount() const
 {
-    int currentRow = equationsList->currentRow();
-    if (currentRow >= 0 && currentRow < plots.size()) {
-        plots[currentRow].visible = (state == Qt::Checked);
-        onGeneratePlotClicked(); // Update the plot
-    }
+    const qreal pixels = chart->plotArea().width() * chartView->devicePixelRatioF();
+    return qBound(pointsSpinBox->minimum(), qRound(pixels * oversamplingSpinBox->value()), pointsSpinBox->maximum());
 }
 
-void PlotterMainWindow::onEquationColorChanged()
+void PlotterMainWindow::updateAutoPoints(bool force)
 {
-    int currentRow = equationsList->currentRow();
-    if (currentRow >= 0 && currentRow < plots.size()) {
-        QColor newColor = QColorDialog::getColor(plots[currentRow].color, this, "Select Equation Color");
-
-        if (newColor.isValid()) {
-            // Update the color
-            plots[currentRow].color = newColor;
+    if (!autoPointsCheckBox->isChecked()) {
+        return;
+    }
 
-            // Update the color button
-            QString colorStyle = QString("background-color: %1").arg(newColor.name());
-            colorButton->setStyleSheet(colorStyle);
+    // Small width changes keep the current samples, so a resize re-samples
+    // only once the displayed resolution has really moved
+    const int points = autoPointCount();
+    const int current = pointsSpinBox->value();
+    if (points == current || (!force && std::abs(points - current) <= current * AutoPointsThreshold)) {
+        return;
+    }
 
-            // Update the plot
-            onGeneratePlotClicked();
-        }
+    pointsSpinBox->setValue(points);
+    if (!plots.isEmpty()) {
+        onGeneratePlotClicked();
     }
 }
 
-void PlotterMainWindow::onLineWidthChanged(double width)
+MathMode PlotterMainWindow::previewMathMode() const
 {
-    int currentRow = equationsList->currentRow();
-    if (currentRow >= 0 && currentRow < plots.size()) {
-        plots[currentRow].lineWidth = width;
-        onGeneratePlotClicked(); // Update the plot
-    }
+    return fastMathCheckBox->isChecked() && !m_exporting ? MathMode::Fast : MathMode::Exact;
 }
 
-double PlotterMainWindow::evaluateExpression(const QString &expression, double x)
+void PlotterMainWindow::refinePreviews()
 {
-    // Replace x with its value
-    QString jsExpression = expression;
-    jsExpression.replace("x", QString::number(x));
-
-    // Add support for common mathematical functions and constants
-    static bool engineInitialized = false;
-    if (!engineInitialized) {
-        // Define Math library functions
-        jsEngine.evaluate(
-            "function sin(x) { return Math.sin(x); }"
-            "function cos(x) { return Math.cos(x); }"
-            "function tan(x) { return Math.tan(x); }"
-            "function sqrt(x) { return Math.sqrt(x); }"
-            "function abs(x) { return Math.abs(x); }"
-            "function log(x) { return Math.log(x); }"  // Natural log
-            "function log10(x) { return Math.log10(x); }"
-            "function exp(x) { return Math.exp(x); }"
-            "function pow(x, y) { return Math.pow(x, y); }"
-            "var pi = Math.PI;"
-            "var e = Math.E;"
-            );
-        engineInitialized = true;
+    const double xMin = xMinSpinBox->value();
+    const double xMax = xMaxSpinBox->value();
+    const double yMin = yMinSpinBox->value();
+    const double yMax = yMaxSpinBox->value();
+    const int numPoints = pointsSpinBox->value();
+    if (xMin >= xMax || yMin >= yMax) {
+        return;
     }
+    const double step = (xMax - xMin) / (numPoints - 1);
+    const SamplePrecision precision = static_cast<SamplePrecision>(precisionComboBox->currentIndex());
 
-    // Handle common operations that might not be JS compatible
-    jsExpression.replace("^", "**");  // Replace ^ with ** for exponentiation
+    // Re-evaluate with libm whatever the previews sampled with fast math
+    bool gridReady = false;
+    for (int i = 0; i < plots.size(); i++) {
+        EquationPlot &plot = plots[i];
+        if (plot.type != PlotType::Function || !isPlotted(plot) || plot.samples.mathMode != MathMode::Fast) {
+            continue;
+        }
+        if (!gridReady) {
+            prepareSampleGrid(xMin, step, numPoints);
+            gridReady = true;
+        }
+        generateFunctionPlot(plot, xMin, step, numPoints, yMin, yMax, precision, MathMode::Exact);
+    }
 
-    // Evaluate the expression
-    QJSValue result = jsEngine.evaluate(jsExpression);
+    // The heatmap and map pick their mode from the checkbox and export state,
+    // the map iterates again only if that changed its mode
+    updateHeatmapLayer();
+    updateMapLayer();
+    updateDiagnosticsLabel();
+}
 
-    if (result.isError()) {
-        qDebug() << "Error evaluating expression:" << jsExpression;
-        qDebug() << "Error:" << result.toString();
-        return 0;
+void PlotterMainWindow::prepareSampleGrid(double xMin, double step, int numPoints)
+{
+    // Sample positions shared by every function plot, pooled across regenerations
+    sampleXs.resize(numPoints);
+    sampleValues.resize(numPoints);
+    sampleDerivatives.resize(numPoints);
+    secondDerivativeScratch.resize(numPoints);
+    double *xs = sampleXs.data();
+    for (int j = 0; j < numPoints; j++) {
+        xs[j] = xMin + j * step;
     }
-
-    return result.toNumber();
 }
 
-void PlotterMainWindow::onEquationDoubleClicked(QListWidgetItem *item)
+bool PlotterMainWindow::generateFunctionPlot(EquationPlot &plot, double xMin, double step, int numPoints,
+                                             double yMin, double yMax, SamplePrecision precision, MathMode mathMode)
 {
-    int row = equationsList->row(item);
+    const double *xs = sampleXs.constData();
+    double *ys = sampleValues.data();
+    double *dys = sampleDerivatives.data();
+    SampleCache &samples = plot.samples;
+    EquationDiagnostics &diagnostics = plot.diagnostics;
+    diagnostics.reset();
+
+    // Derivatives come from the compiled engine's jets, the JavaScript fallback
+    // has none. Those plots are drawn without them and the reason is recorded.
+    const bool showDerivative = plot.showDerivative && plot.compiled.isValid();
+    const bool showSecondDerivative = plot.showSecondDerivative && plot.compiled.isValid();
+    const bool wantDerivatives = showDerivative || showSecondDerivative;
+    if (!plot.compiled.isValid() && (plot.showDerivative || plot.showSecondDerivative)) {
+        diagnostics.derivativeError = "the equation is evaluated by JavaScript";
+    }
+
+    // Samples of a function of t belong to the t they were taken at
+    QVector<double> parameters = parameterValues(plot);
+    if (plot.compiled.isValid() && plot.compiled.usesSlot(Oscilloscope::TimeSlot)) {
+        parameters.append(m_time);
+    }
+    ExpressionBindings parameterBindings;
+    bindParameters(plot, parameterBindings);
+
+    // Reuse the cached samples when nothing that affects them changed, so
+    // restyling or toggling other equations doesn't re-evaluate this one
+    const bool cached = samples.matches(plot.equation, parameters, xMin, step, numPoints, precision, mathMode) &&
+                        (!showDerivative || !samples.dy.isEmpty()) && !showSecondDerivative;
+
+    // A coarser grid inside the sampled range, e.g. after zooming in on a densely
+    // sampled wide view, is drawn from the min/max pyramid of the cached samples.
+    // The cache keeps its finer base samples for the next change of view.
+    if (!cached && !wantDerivatives &&
+        samples.covers(plot.equation, parameters, xMin, step, numPoints, mathMode)) {
+        envelopeXs.resize(2 * numPoints);
+        envelopeYs.resize(2 * numPoints);
+        const int count = samples.pyramid.envelope(samples.y, samples.xMin, samples.step, xMin, step, numPoints,
+                                                   envelopeXs.data(), envelopeYs.data());
+        diagnostics.cached = true;
+        diagnostics.countSamples(envelopeYs.constData(), count, yMin, yMax);
+        diagnostics.culled = std::max(0, qRound((numPoints - 1) * step / samples.step) + 1 - count);
+        curveSegments.build(envelopeXs.constData(), envelopeYs.constData(), count, yMin, yMax);
+        const bool hasPoints = updateCurveSeries(plot.series, plot.name, QPen(plot.color, plot.lineWidth), curveSegments);
+        removeCurveSeries(plot.derivativeSeries, plot.name + "'");
+        removeCurveSeries(plot.secondDerivativeSeries, plot.name + "''");
+        return hasPoints;
+    }
+
+    QElapsedTimer evaluationTimer;
+    evaluationTimer.start();
+    if (cached) {
+        samples.y.load(ys, 0, numPoints);
+        if (showDerivative) {
+            samples.dy.load(dys, 0, numPoints);
+        }
+    } else if (plot.compiled.isValid()) {
+        // One batched pass over all x, derivatives come out of the same pass.
+        // Parameters are bound as scalar slots, the program itself never changes.
+        // Jets have no fast path, with derivatives the samples are always exact.
+        ExpressionBindings bindings = parameterBindings;
+        bindings.streams[0] = xs;
+        if (wantDerivatives) {
+            plot.compiled.evaluateBatchJet(bindings, 0, ys, dys, secondDerivativeScratch.data(), numPoints);
+            mathMode = MathMode::Exact;
+        } else {
+            plot.compiled.evaluateBatch(bindings, ys, numPoints, mathMode);
+        }
+    } else {
+        // Fall back to the JavaScript evaluator for anything the engine can't parse.
+        // Its errors don't depend on x, the first one leaves the rest NaN.
+        for (int j = 0; j < numPoints; j++) {
+            ys[j] = evaluateExpression(plot.equation, xs[j], &diagnostics.evaluationError);
+            if (!diagnostics.evaluationError.isEmpty()) {
+                std::fill(ys + j, ys + numPoints, std::numeric_limits<double>::quiet_NaN());
+                break;
+            }
+        }
+    }
+
+    // Counted once over the finished samples, never inside the loops above
+    diagnostics.cached = cached;
+    diagnostics.evaluations = cached ? 0 : numPoints;
+    diagnostics.evaluationNs = cached ? 0 : evaluationTimer.nsecsElapsed();
+    diagnostics.countSamples(ys, numPoints, yMin, yMax);
+
+    // Store the samples in the cache for the analysis pass and later reuse
+    if (!cached) {
+        samples.equation = plot.equation;
+        samples.parameters = parameters;
+        samples.mathMode = plot.compiled.isValid() ? mathMode : MathMode::Exact;
+        samples.xMin = xMin;
+        samples.step = step;
+        samples.y.store(ys, numPoints, precision);
+        samples.pyramid.build(samples.y);
+        if (wantDerivatives) {
+            samples.dy.store(dys, numPoints, precision);
+        } else {
+            samples.dy.clear();
+        }
+    }
+
+    // Split into drawable segments, the compiled expression pins down the edges
+    const CompiledExpression *expression = plot.compiled.isValid() ? &plot.compiled : nullptr;
+    curveSegments.build(xs, ys, numPoints, yMin, yMax, expression, parameterBindings);
+
+    // Refill the equation's series, creating it on first use
+    const bool hasPoints = updateCurveSeries(plot.series, plot.name, QPen(plot.color, plot.lineWidth), curveSegments);
+
+    if (showDerivative) {
+        curveSegments.build(xs, dys, numPoints, yMin, yMax);
+        updateCurveSeries(plot.derivativeSeries, plot.name + "'", QPen(plot.color, plot.lineWidth, Qt::DashLine),
+                          curveSegments);
+    } else {
+        removeCurveSeries(plot.derivativeSeries, plot.name + "'");
+    }
+    if (showSecondDerivative) {
+        curveSegments.build(xs, secondDerivativeScratch.constData(), numPoints, yMin, yMax);
+        updateCurveSeries(plot.secondDerivativeSeries, plot.name + "''", QPen(plot.color, plot.lineWidth, Qt::DotLine),
+                          curveSegments);
+    } else {
+        removeCurveSeries(plot.secondDerivativeSeries, plot.name + "''");
+    }
+
+    return hasPoints;
+}
+
+void PlotterMainWindow::enforceCacheBudget()
+{
+    const qsizetype budget = qsizetype(cacheBudgetSpinBox->value()) * 1024 * 1024;
+
+    qsizetype used = 0;
+    QList<int> order;
+    for (int i = 0; i < plots.size(); i++) {
+        if (!plots[i].samples.isEmpty()) {
+            used += plots[i].samples.reservedBytes();
+            order.append(i);
+        }
+    }
+
+    // Evict the caches of the least recently visible equations first
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return plots[a].lastVisible < plots[b].lastVisible;
+    });
+    for (int i : order) {
+        if (used <= budget) {
+            break;
+        }
+        used -= plots[i].samples.reservedBytes();
+        plots[i].samples.clear();
+    }
+
+    // Free pooled blocks beyond what the budget has left
+    SampleBufferPool::instance().trim(std::max<qsizetype>(0, budget - used));
+
+    cacheMemoryLabel->setText(QString("Sample cache: %1 MB").arg(used / (1024.0 * 1024.0), 0, 'f', 1));
+}
+
+bool PlotterMainWindow::generateOdePlot(EquationPlot &plot, double xMin, double xMax, double yMin, double yMax,
+                                        double step)
+{
+    ExpressionBindings bindings;
+    bindParameters(plot, bindings);
+
+    // Solutions are sampled on the same grid as the function curves
+    SegmentedCurve solutions;
+    const double tolerance = std::pow(10.0, -odeToleranceSpinBox->value());
+    plot.diagnostics.reset();
+    QElapsedTimer evaluationTimer;
+    evaluationTimer.start();
+    const OdeSolver::Statistics statistics = OdeSolver::solve(plot.compiled, bindings, plot.initialValues,
+                                                              xMin, xMax, yMin, yMax, tolerance, step, solutions);
+    plot.diagnostics.evaluations = statistics.evaluations;
+    plot.diagnostics.evaluationNs = evaluationTimer.nsecsElapsed();
+    const bool hasPoints = updateCurveSeries(plot.series, plot.name, QPen(plot.color, plot.lineWidth), solutions);
+    plot.solutionIndex.build(solutions.points());
+
+    // Slope segments of equal screen length, faded so the solutions stand out
+    const QString fieldName = plot.name + " (field)";
+    if (directionFieldCheckBox->isChecked()) {
+        const QSizeF pixels = chart->plotArea().size();
+        const int columns = std::max(1, int(pixels.width() / DirectionFieldCell));
+        const int rows = std::max(1, int(pixels.height() / DirectionFieldCell));
+        SegmentedCurve field;
+        OdeSolver::directionField(plot.compiled, bindings, QRectF(xMin, yMin, xMax - xMin, yMax - yMin), pixels,
+                                  columns, rows, 0.7 * DirectionFieldCell, field);
+        QColor fieldColor = plot.color;
+        fieldColor.setAlpha(110);
+        curveLayer->setCurve(fieldName, QPen(fieldColor, 1.0), field);
+    } else {
+        curveLayer->removeCurve(fieldName);
+    }
+
+    odeInfoLabel->setText(QString("%1: %2 solutions, %3 steps (%4 rejected), %5 evaluations")
+                              .arg(plot.name)
+                              .arg(plot.initialValues.size())
+                              .arg(statistics.steps)
+                              .arg(statistics.rejected)
+                              .arg(statistics.evaluations));
+    return hasPoints;
+}
+
+void PlotterMainWindow::onInitialValuesEdited()
+{
+    const int row = currentEquationRow();
+    if (row < 0 || row >= plots.size() || plots[row].type != PlotType::Ode) {
+        return;
+    }
+
+    QString error;
+    const QVector<QPointF> values = OdeSolver::parseInitialValues(initialValuesInput->text(), &error);
+    if (values.isEmpty()) {
+        QMessageBox::warning(this, "Invalid Initial Values", error);
+        initialValuesInput->setText(OdeSolver::formatInitialValues(plots[row].initialValues));
+        return;
+    }
+    if (values == plots[row].initialValues) {
+        return;
+    }
+    plots[row].initialValues = values;
+    if (isPlotted(plots[row])) {
+        onGeneratePlotClicked();
+    }
+}
+
+void PlotterMainWindow::onOdeOptionsChanged()
+{
+    for (const EquationPlot &plot : plots) {
+        if (plot.type == PlotType::Ode && isPlotted(plot)) {
+            onGeneratePlotClicked();
+            return;
+        }
+    }
+}
+
+bool PlotterMainWindow::updateCurveSeries(QLineSeries *&series, const QString &name, const QPen &pen,
+                                          const SegmentedCurve &curve)
+{
+    if (curve.isEmpty()) {
+        removeCurveSeries(series, name);
+        return false;
+    }
+
+    // In single-layer mode the curve goes to the shared layer instead of its own series.
+    // A series can't lift the pen between segments, so broken curves go there as well.
+    if (singleLayerCheckBox->isChecked() || curve.segmentCount() > 1) {
+        removeCurveSeries(series, QString());
+        curveLayer->setCurve(name, pen, curve);
+        return true;
+    }
+    curveLayer->removeCurve(name);
+
+    // Reuse the series from the previous regeneration when there is one
+    if (!series) {
+        series = new QLineSeries();
+        chart->addSeries(series);
+        series->attachAxis(axisX);
+        series->attachAxis(axisY);
+    }
+    series->setName(name);
+    series->setColor(pen.color());
+    series->setPen(pen);
+    series->replace(curve.points());
+    return true;
+}
+
+void PlotterMainWindow::removeCurveSeries(QLineSeries *&series, const QString &name)
+{
+    if (!name.isEmpty()) {
+        curveLayer->removeCurve(name);
+    }
+    if (series) {
+        chart->removeSeries(series);
+        delete series;
+        series = nullptr;
+    }
+}
+
+void PlotterMainWindow::removeSeriesOf(EquationPlot &plot)
+{
+    removeCurveSeries(plot.series, plot.name);
+    removeCurveSeries(plot.derivativeSeries, plot.name + "'");
+    removeCurveSeries(plot.secondDerivativeSeries, plot.name + "''");
+    curveLayer->removeCurve(plot.name + " (field)");
+}
+
+bool PlotterMainWindow::isPlotted(const EquationPlot &plot) const
+{
+    return plot.series || curveLayer->hasCurve(plot.name);
+}
+
+void PlotterMainWindow::updateCurveLayer()
+{
+    const QRectF world(axisX->min(), axisY->min(), axisX->max() - axisX->min(), axisY->max() - axisY->min());
+    curveLayer->setView(world, chart->plotArea());
+    crosshairLayer->setView(world, chart->plotArea());
+}
+
+void PlotterMainWindow::updateCrosshair(const QPoint &viewportPos)
+{
+    const QPointF position = chart->mapFromScene(chartView->mapToScene(viewportPos));
+    const QRectF plotArea = chart->plotArea();
+    if (!plotArea.contains(position) || plotArea.isEmpty()) {
+        crosshairLayer->hideCursor();
+        return;
+    }
+
+    // Cursor in world coordinates, y grows downwards on screen
+    const double xRange = axisX->max() - axisX->min();
+    const double yRange = axisY->max() - axisY->min();
+    const QPointF cursor(axisX->min() + (position.x() - plotArea.left()) / plotArea.width() * xRange,
+                         axisY->max() - (position.y() - plotArea.top()) / plotArea.height() * yRange);
+
+    // Markers and solution points count as under the cursor within a few pixels
+    constexpr double SnapPixels = 6.0;
+    const QSizeF radius(SnapPixels / plotArea.width() * xRange, SnapPixels / plotArea.height() * yRange);
+
+    // f(x) of every plotted function, straight from the compiled expression
+    // where there is one so the cost is independent of how many samples are cached
+    struct Hit {
+        double distance;
+        int row;
+        QPointF point;
+    };
+    QVector<Hit> hits;
+    ExpressionBindings bindings;
+    for (int i = 0; i < plots.size(); i++) {
+        const EquationPlot &plot = plots[i];
+        if (!plot.visible || !isPlotted(plot)) {
+            continue;
+        }
+        if (plot.type == PlotType::Ode) {
+            // Solutions aren't functions of the cursor's x, the nearest drawn
+            // solution point within reach is read instead
+            const int nearest = plot.solutionIndex.nearest(cursor, radius);
+            if (nearest >= 0) {
+                const QPointF point = plot.solutionIndex.at(nearest);
+                hits.append({ std::fabs(point.y() - cursor.y()), i, point });
+            }
+            continue;
+        }
+        if (plot.type != PlotType::Function) {
+            continue;
+        }
+
+        // Equations only the JavaScript evaluator understands are read from
+        // their cached samples, calling into it on every mouse move is too slow
+        double y;
+        if (plot.compiled.isValid()) {
+            bindParameters(plot, bindings);
+            bindings.values[0] = cursor.x();
+            y = plot.compiled.evaluate(bindings);
+        } else if (plot.samples.equation == plot.equation) {
+            y = plot.samples.interpolate(cursor.x());
+        } else {
+            continue;
+        }
+        if (std::isfinite(y)) {
+            hits.append({ std::fabs(y - cursor.y()), i, QPointF(cursor.x(), y) });
+        }
+    }
+
+    // Only the curves nearest to the cursor are listed
+    const int listed = qMin(int(hits.size()), CrosshairLayer::MaxReadings);
+    std::partial_sort(hits.begin(), hits.begin() + listed, hits.end(),
+                      [](const Hit &a, const Hit &b) { return a.distance < b.distance; });
+
+    QVector<CrosshairReading> readings;
+    for (int k = 0; k < listed; k++) {
+        const EquationPlot &plot = plots[hits[k].row];
+        const QPointF &point = hits[k].point;
+        QString text = QString("%1: %2").arg(plot.name).arg(point.y(), 0, 'g', 10);
+        if (plot.type == PlotType::Ode) {
+            text = QString("%1: (%2, %3)").arg(plot.name).arg(point.x(), 0, 'g', 10).arg(point.y(), 0, 'g', 10);
+        }
+        readings.append({ text, plot.color, point });
+    }
+
+    // z under the cursor on the visible heatmap, or f(z) of a complex function
+    if (m_heatmapIndex >= 0 && m_heatmapIndex < plots.size() && heatmapLayer->hasImage() &&
+        plots[m_heatmapIndex].type == PlotType::Complex) {
+        const EquationPlot &plot = plots[m_heatmapIndex];
+        ExpressionBindings re;
+        ExpressionBindings im;
+        bindParameters(plot, re);
+        re.values[0] = cursor.x();
+        im.values[0] = cursor.y();
+        im.values[1] = 1.0;
+        double wRe = 0.0;
+        double wIm = 0.0;
+        plot.compiled.evaluateBatchComplex(re, im, &wRe, &wIm, 1);
+        readings.prepend({ QString("%1: f = %2 %3 %4i, |f| = %5")
+                               .arg(plot.name)
+                               .arg(wRe, 0, 'g', 8)
+                               .arg(QString(wIm < 0.0 ? "-" : "+"))
+                               .arg(std::fabs(wIm), 0, 'g', 8)
+                               .arg(std::hypot(wRe, wIm), 0, 'g', 8),
+                           plot.color, cursor });
+    } else if (m_heatmapIndex >= 0 && m_heatmapIndex < plots.size() && heatmapLayer->hasImage()) {
+        const EquationPlot &plot = plots[m_heatmapIndex];
+        ExpressionBindings heatmapBindings;
+        bindParameters(plot, heatmapBindings);
+        heatmapBindings.values[0] = cursor.x();
+        heatmapBindings.values[1] = cursor.y();
+        const double z = plot.compiled.evaluate(heatmapBindings);
+        readings.prepend({ QString("%1: z = %2").arg(plot.name).arg(z, 0, 'g', 10), plot.color, cursor });
+    }
+
+    // Feature markers within a few pixels, looked up in the spatial index
+    const int feature = featureIndex.nearest(cursor, radius);
+    if (feature >= 0) {
+        readings.prepend({ featureLabels[feature], QColor(255, 255, 255), featureIndex.at(feature) });
+    }
+
+    crosshairLayer->setCursor(cursor, readings, int(hits.size()) - listed);
+}
+
+QStringList PlotterMainWindow::baseVariables(PlotType type)
+{
+    // t of function equations is the oscilloscope time, slot Oscilloscope::TimeSlot.
+    // Heatmaps and differential equations are functions of x and y, maps of x and r.
+    // Complex functions take z, with i bound to the imaginary unit.
+    if (type == PlotType::Function) {
+        return QStringList{ "x", "t" };
+    }
+    if (type == PlotType::Complex) {
+        return QStringList{ "z", "i" };
+    }
+    return type == PlotType::IteratedMap ? QStringList{ "x", "r" } : QStringList{ "x", "y" };
+}
+
+bool PlotterMainWindow::compileEquation(EquationPlot &plot, QString *error)
+{
+    // Any other name in the equation becomes a free parameter slot after x (and y)
+    const QStringList variables = baseVariables(plot.type);
+    QString message;
+    const bool compiled = plot.compiled.compile(plot.equation,
+                                                variables + CompiledExpression::freeNames(plot.equation, variables),
+                                                &message);
+
+    // The counters belong to the previous equation
+    plot.diagnostics = EquationDiagnostics();
+    plot.diagnostics.compileError = compiled ? QString() : message;
+    if (error) {
+        *error = message;
+    }
+    return compiled;
+}
+
+bool PlotterMainWindow::validateEquation(EquationPlot &plot, QString *error)
+{
+    // Everything but functions runs on the compiled engine only
+    QString message;
+    if (compileEquation(plot, &message)) {
+        return true;
+    }
+    if (plot.type != PlotType::Function) {
+        *error = "Cannot compile equation: " + message;
+        return false;
+    }
+
+    // Functions the engine can't parse fall back to JavaScript, which is
+    // checked once here rather than failing again at every sample
+    evaluateExpression(plot.equation, 0.0, &message);
+    if (!message.isEmpty()) {
+        *error = "Cannot evaluate equation: " + message;
+        return false;
+    }
+    return true;
+}
+
+QStringList PlotterMainWindow::parameterNames(const EquationPlot &plot)
+{
+    if (!plot.compiled.isValid()) {
+        return QStringList();
+    }
+    return plot.compiled.variables().mid(baseVariables(plot.type).size());
+}
+
+QVector<double> PlotterMainWindow::parameterValues(const EquationPlot &plot) const
+{
+    QVector<double> values;
+    for (const QString &name : parameterNames(plot)) {
+        const int index = m_parameterIndex.value(name, -1);
+        values.append(index >= 0 ? parameters[index].value : 0.0);
+    }
+    return values;
+}
+
+void PlotterMainWindow::bindParameters(const EquationPlot &plot, ExpressionBindings &bindings) const
+{
+    const int first = baseVariables(plot.type).size();
+    if (plot.type == PlotType::Function) {
+        bindings.values[Oscilloscope::TimeSlot] = m_time;
+    }
+    const QVector<double> values = parameterValues(plot);
+    for (int k = 0; k < values.size(); k++) {
+        bindings.values[first + k] = values[k];
+    }
+}
+
+void PlotterMainWindow::syncParameters()
+{
+    // Collect the parameters named by any equation in order of first use,
+    // keeping the values of existing ones
+    QHash<QString, double> previous;
+    for (const PlotParameter &parameter : parameters) {
+        previous.insert(parameter.name, parameter.value);
+    }
+    QList<PlotParameter> updated;
+    QHash<QString, int> index;
+    for (const EquationPlot &plot : plots) {
+        for (const QString &name : parameterNames(plot)) {
+            if (index.contains(name)) {
+                continue;
+            }
+            PlotParameter parameter;
+            parameter.name = name;
+            parameter.value = previous.value(name, parameter.value);
+            index.insert(name, int(updated.size()));
+            updated.append(parameter);
+        }
+    }
+    parameters = updated;
+    m_parameterIndex = index;
+
+    // Drop the rows of parameters no equation uses any more
+    for (auto it = m_parameterRows.begin(); it != m_parameterRows.end();) {
+        if (m_parameterIndex.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        delete it->label;
+        delete it->slider;
+        delete it->valueSpinBox;
+        it = m_parameterRows.erase(it);
+    }
+
+    // Add rows for new parameters, move rows whose position changed and
+    // refresh values set from outside the sliders, e.g. by opening a session
+    for (int i = 0; i < parameters.size(); i++) {
+        const PlotParameter &parameter = parameters[i];
+        auto row = m_parameterRows.find(parameter.name);
+        if (row == m_parameterRows.end()) {
+            row = m_parameterRows.insert(parameter.name, createParameterRow(parameter.name, parameter.value));
+        } else if (row->valueSpinBox->value() != parameter.value) {
+            QSignalBlocker blockSlider(row->slider);
+            QSignalBlocker blockSpinBox(row->valueSpinBox);
+            row->slider->setValue(qRound(parameter.value * ParameterSliderSteps));
+            row->valueSpinBox->setValue(parameter.value);
+        }
+
+        int position = -1;
+        const int item = parametersGrid->indexOf(row->label);
+        if (item >= 0) {
+            int column, rowSpan, columnSpan;
+            parametersGrid->getItemPosition(item, &position, &column, &rowSpan, &columnSpan);
+        }
+        if (position != i) {
+            parametersGrid->removeWidget(row->label);
+            parametersGrid->removeWidget(row->slider);
+            parametersGrid->removeWidget(row->valueSpinBox);
+            parametersGrid->addWidget(row->label, i, 0);
+            parametersGrid->addWidget(row->slider, i, 1);
+            parametersGrid->addWidget(row->valueSpinBox, i, 2);
+        }
+    }
+    parametersGroup->setVisible(!parameters.isEmpty());
+
+    // Any parameter can be swept, the list only changes with the parameter names
+    bool renamed = sweepParameterComboBox->count() != parameters.size();
+    for (int i = 0; i < parameters.size() && !renamed; i++) {
+        renamed = sweepParameterComboBox->itemText(i) != parameters[i].name;
+    }
+    if (renamed) {
+        const QString swept = sweepParameterComboBox->currentText();
+        sweepParameterComboBox->clear();
+        for (const PlotParameter &parameter : parameters) {
+            sweepParameterComboBox->addItem(parameter.name);
+        }
+        sweepParameterComboBox->setCurrentIndex(qMax(0, sweepParameterComboBox->findText(swept)));
+    }
+}
+
+ParameterRow PlotterMainWindow::createParameterRow(const QString &name, double value)
+{
+    ParameterRow row;
+    row.label = new QLabel(name + ":");
+
+    QSlider *slider = new QSlider(Qt::Horizontal);
+    slider->setRange(-10 * ParameterSliderSteps, 10 * ParameterSliderSteps);
+    slider->setValue(qRound(value * ParameterSliderSteps));
+    row.slider = slider;
+
+    QDoubleSpinBox *valueSpinBox = new QDoubleSpinBox();
+    valueSpinBox->setRange(-1000000, 1000000);
+    valueSpinBox->setDecimals(3);
+    valueSpinBox->setSingleStep(1.0 / ParameterSliderSteps);
+    valueSpinBox->setValue(value);
+    row.valueSpinBox = valueSpinBox;
+
+    // Slider and spin box mirror each other, the slider covers -10..10
+    connect(slider, &QSlider::valueChanged, this, [this, name, valueSpinBox](int position) {
+        QSignalBlocker block(valueSpinBox);
+        valueSpinBox->setValue(double(position) / ParameterSliderSteps);
+        setParameterValue(name, valueSpinBox->value());
+    });
+    connect(valueSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this,
+            [this, name, slider](double value) {
+        QSignalBlocker block(slider);
+        slider->setValue(qRound(value * ParameterSliderSteps));
+        setParameterValue(name, value);
+    });
+    return row;
+}
+
+void PlotterMainWindow::setParameterValue(const QString &name, double value)
+{
+    const int index = m_parameterIndex.value(name, -1);
+    if (index >= 0) {
+        parameters[index].value = value;
+    }
+
+    // Coalesce slider moves into at most one re-evaluation per frame
+    m_dirtyParameters.insert(name);
+    if (!parameterTimer->isActive()) {
+        parameterTimer->start();
+    }
+}
+
+void PlotterMainWindow::onParameterFrame()
+{
+    const QSet<QString> dirty = m_dirtyParameters;
+    m_dirtyParameters.clear();
+
+    const double xMin = xMinSpinBox->value();
+    const double xMax = xMaxSpinBox->value();
+    const double yMin = yMinSpinBox->value();
+    const double yMax = yMaxSpinBox->value();
+    const int numPoints = pointsSpinBox->value();
+    if (xMin >= xMax || yMin >= yMax) {
+        return;
+    }
+    const double step = (xMax - xMin) / (numPoints - 1);
+    const SamplePrecision precision = static_cast<SamplePrecision>(precisionComboBox->currentIndex());
+
+    // Re-evaluate only the plotted equations that use a changed parameter
+    bool changed = false;
+    bool heatmapChanged = false;
+    bool mapChanged = false;
+    bool gridReady = false;
+    for (int i = 0; i < plots.size(); i++) {
+        EquationPlot &plot = plots[i];
+        bool affected = false;
+        for (const QString &name : parameterNames(plot)) {
+            affected = affected || dirty.contains(name);
+        }
+        if (!affected) {
+            continue;
+        }
+
+        if (plot.type == PlotType::Heatmap || plot.type == PlotType::Complex) {
+            heatmapChanged = heatmapChanged || i == m_heatmapIndex;
+        } else if (plot.type == PlotType::IteratedMap) {
+            mapChanged = mapChanged || i == m_mapIndex;
+        } else if (plot.type == PlotType::Ode) {
+            if (isPlotted(plot)) {
+                generateOdePlot(plot, xMin, xMax, yMin, yMax, step);
+                changed = true;
+            }
+        } else if (isPlotted(plot)) {
+            if (!gridReady) {
+                prepareSampleGrid(xMin, step, numPoints);
+                gridReady = true;
+            }
+            generateFunctionPlot(plot, xMin, step, numPoints, yMin, yMax, precision, previewMathMode());
+            changed = true;
+        }
+    }
+
+    // Markers belong to the previous curves, the layers redraw only for their own plot
+    if (changed || heatmapChanged || mapChanged) {
+        clearFeatures();
+        updateDiagnosticsLabel();
+    }
+    if (heatmapChanged) {
+        updateHeatmapLayer();
+    }
+    if (mapChanged) {
+        updateMapLayer();
+    }
+
+    // Animated equations pick up the new parameter values
+    if (oscilloscopeTimer->isActive()) {
+        startOscilloscope();
+    }
+}
+
+void PlotterMainWindow::startOscilloscope()
+{
+    // One trace per plotted function of t, its derivatives aren't animated
+    m_oscilloscope.clear();
+    for (EquationPlot &plot : plots) {
+        if (plot.type != PlotType::Function || !plot.visible || !plot.compiled.isValid() ||
+            !plot.compiled.usesSlot(Oscilloscope::TimeSlot) || !isPlotted(plot)) {
+            continue;
+        }
+        ExpressionBindings bindings;
+        bindParameters(plot, bindings);
+        m_oscilloscope.addTrace(plot.name, plot.compiled, bindings);
+        removeCurveSeries(plot.derivativeSeries, plot.name + "'");
+        removeCurveSeries(plot.secondDerivativeSeries, plot.name + "''");
+    }
+    m_oscilloscope.resetStatistics();
+    m_frameClock.start();
+}
+
+void PlotterMainWindow::onRunTimeToggled(bool running)
+{
+    runTimeButton->setText(running ? "Pause" : "Run");
+    if (running) {
+        m_timeOrigin = m_time;
+        m_timeClock.start();
+        startOscilloscope();
+        oscilloscopeTimer->start();
+        return;
+    }
+
+    // Redraw at the final t with exact math and the derivatives back
+    oscilloscopeTimer->stop();
+    m_oscilloscope.clear();
+    if (!plots.isEmpty()) {
+        onGeneratePlotClicked();
+    }
+}
+
+void PlotterMainWindow::onResetTimeClicked()
+{
+    m_time = 0.0;
+    m_timeOrigin = 0.0;
+    m_timeClock.restart();
+    timeInfoLabel->setText("t = 0");
+    if (!oscilloscopeTimer->isActive() && !plots.isEmpty()) {
+        onGeneratePlotClicked();
+    }
+}
+
+void PlotterMainWindow::onOscilloscopeFrame()
+{
+    const double xMin = xMinSpinBox->value();
+    const double xMax = xMaxSpinBox->value();
+    const double yMin = yMinSpinBox->value();
+    const double yMax = yMaxSpinBox->value();
+    const int numPoints = pointsSpinBox->value();
+    if (xMin >= xMax || yMin >= yMax || m_oscilloscope.traceCount() == 0) {
+        return;
+    }
+
+    // The worker missed the frame, the current curves stay up
+    if (m_oscilloscope.isBusy()) {
+        m_oscilloscope.recordDropped();
+        return;
+    }
+
+    // Swap the finished buffers into the existing series or curve layer entries
+    if (m_oscilloscope.collect()) {
+        m_time = m_oscilloscope.lastTime();
+        for (int k = 0; k < m_oscilloscope.traceCount(); k++) {
+            const Oscilloscope::Trace &trace = m_oscilloscope.trace(k);
+            const int row = plots.indexOf(trace.name);
+            if (row >= 0) {
+                EquationPlot &plot = plots[row];
+                updateCurveSeries(plot.series, plot.name, QPen(plot.color, plot.lineWidth), trace.current());
+            }
+        }
+        m_oscilloscope.recordFrame(m_frameClock.nsecsElapsed());
+        m_frameClock.restart();
+        m_presentedFrames++;
+    }
+
+    // Evaluate the next frame while this one is shown
+    const double time = m_timeOrigin + m_timeClock.nsecsElapsed() / 1e9 * timeSpeedSpinBox->value();
+    const double step = (xMax - xMin) / (numPoints - 1);
+    m_oscilloscope.submit(time, xMin, step, numPoints, yMin, yMax, previewMathMode());
+
+    // A few label updates per second are enough
+    if (m_presentedFrames % 10 == 0) {
+        const double average = m_oscilloscope.averageFrameMs();
+        timeInfoLabel->setText(QString("t = %1 | %2 fps, %3 ms avg, %4 ms worst, %5 dropped")
+                                   .arg(m_time, 0, 'f', 2)
+                                   .arg(average > 0.0 ? 1000.0 / average : 0.0, 0, 'f', 1)
+                                   .arg(average, 0, 'f', 1)
+                                   .arg(m_oscilloscope.worstFrameMs(), 0, 'f', 1)
+                                   .arg(m_oscilloscope.droppedFrames()));
+    }
+}
+
+void PlotterMainWindow::clearFeatures()
+{
+    for (QScatterSeries **markers : { &rootMarkers, &extremaMarkers, &intersectionMarkers }) {
+        if (*markers) {
+            chart->removeSeries(*markers);
+            delete *markers;
+            *markers = nullptr;
+        }
+    }
+    featuresList->clear();
+    featureIndex.clear();
+    featureLabels.clear();
+}
+
+QScatterSeries *PlotterMainWindow::addFeatureSeries(const QString &name, const QColor &color,
+                                                   QScatterSeries::MarkerShape shape)
+{
+    QScatterSeries *markers = new QScatterSeries();
+    markers->setName(name);
+    markers->setColor(color);
+    markers->setBorderColor(color);
+    markers->setMarkerShape(shape);
+    markers->setMarkerSize(8.0);
+    chart->addSeries(markers);
+    markers->attachAxis(axisX);
+    markers->attachAxis(axisY);
+    return markers;
+}
+
+void PlotterMainWindow::onFindFeaturesClicked()
+{
+    clearFeatures();
+
+    // Analyse every function curve sampled by the last regeneration
+    QVector<AnalysisCurve> curves;
+    for (int i = 0; i < plots.size(); i++) {
+        const EquationPlot &plot = plots[i];
+        if (plot.type == PlotType::Function && isPlotted(plot) && !plot.samples.isEmpty()) {
+            AnalysisCurve curve{ i, &plot.compiled, &plot.samples, ExpressionBindings() };
+            bindParameters(plot, curve.bindings);
+            curves.append(curve);
+        }
+    }
+
+    if (curves.isEmpty()) {
+        QMessageBox::warning(this, "No Curves", "Generate a plot with at least one visible equation first.");
+        return;
+    }
+
+    int skippedPairs = 0;
+    const QVector<CurveFeature> features = CurveAnalysis::findFeatures(curves, &skippedPairs);
+
+    QList<QPointF> roots, extrema, intersections;
+    QStringList lines;
+    lines.reserve(features.size());
+    QVector<QPointF> points;
+    points.reserve(features.size());
+    for (const CurveFeature &feature : features) {
+        const QString &name = plots[feature.curve].name;
+        const QString position = QString("x = %1, y = %2").arg(feature.x, 0, 'g', 10).arg(feature.y, 0, 'g', 10);
+        points.append(QPointF(feature.x, feature.y));
+
+        switch (feature.kind) {
+        case FeatureKind::Root:
+            roots.append(QPointF(feature.x, feature.y));
+            lines.append(name + ": root at " + position);
+            break;
+        case FeatureKind::Maximum:
+            extrema.append(QPointF(feature.x, feature.y));
+            lines.append(name + ": maximum at " + position);
+            break;
+        case FeatureKind::Minimum:
+            extrema.append(QPointF(feature.x, feature.y));
+            lines.append(name + ": minimum at " + position);
+            break;
+        case FeatureKind::Intersection:
+            intersections.append(QPointF(feature.x, feature.y));
+            lines.append(name + " x " + plots[feature.other].name + ": intersection at " + position);
+            break;
+        }
+    }
+
+    // Mark the results on the chart, one scatter series per kind
+    rootMarkers = addFeatureSeries("Roots", QColor(255, 255, 255), QScatterSeries::MarkerShapeCircle);
+    rootMarkers->replace(roots);
+    extremaMarkers = addFeatureSeries("Extrema", QColor(255, 215, 0), QScatterSeries::MarkerShapeRectangle);
+    extremaMarkers->replace(extrema);
+    intersectionMarkers = addFeatureSeries("Intersections", QColor(0, 255, 255), QScatterSeries::MarkerShapeCircle);
+    intersectionMarkers->replace(intersections);
+
+    // Hover lookup of the markers, labels in the same order as the points
+    featureIndex.build(points);
+    featureLabels = lines;
+
+    if (lines.isEmpty()) {
+        lines.append("No roots, extrema or intersections found.");
+    }
+    if (skippedPairs > 0) {
+        lines.append(QString("Intersections not searched: %1 pairs of %2 curves, the limit is %3 curves")
+                         .arg(skippedPairs).arg(curves.size()).arg(CurveAnalysis::MaxIntersectionCurves));
+    }
+    featuresList->addItems(lines);
+}
+
+void PlotterMainWindow::updateHeatmapLayer()
+{
+    if (m_heatmapIndex < 0 || m_heatmapIndex >= plots.size()) {
+        heatmapLayer->clear();
+        return;
+    }
+
+    const EquationPlot &plot = plots[m_heatmapIndex];
+    if (plot.type == PlotType::Complex) {
+        updateDomainColoring(plot);
+        return;
+    }
+    const CompiledExpression &expression = heatmapRenderer.expression();
+    if (expression.source() != plot.equation || expression.variables() != plot.compiled.variables() ||
+        !expression.isValid()) {
+        if (!heatmapRenderer.setExpression(plot.equation, parameterNames(plot))) {
+            heatmapLayer->clear();
+            return;
+        }
+    }
+    heatmapRenderer.setParameters(parameterValues(plot));
+    heatmapRenderer.setMathMode(previewMathMode());
+
+    // Evaluate at device resolution over the current axis ranges
+    const QRectF plotArea = chart->plotArea();
+    const qreal dpr = chartView->devicePixelRatioF();
+    const QSize pixels = (plotArea.size() * dpr).toSize();
+    const QRectF world(axisX->min(), axisY->min(), axisX->max() - axisX->min(), axisY->max() - axisY->min());
+
+    QImage image = heatmapRenderer.render(world, pixels);
+    image.setDevicePixelRatio(dpr);
+    heatmapLayer->setImage(image, plotArea);
+}
+
+void PlotterMainWindow::updateMapLayer()
+{
+    if (m_mapIndex < 0 || m_mapIndex >= plots.size() || !plots[m_mapIndex].compiled.isValid()) {
+        mapLayer->clear();
+        return;
+    }
+
+    const EquationPlot &plot = plots[m_mapIndex];
+    ExpressionBindings bindings;
+    bindParameters(plot, bindings);
+    IteratedMap::Settings settings;
+    settings.x0 = mapStartSpinBox->value();
+    settings.transient = mapTransientSpinBox->value();
+    settings.iterations = mapIterationsSpinBox->value();
+    settings.samplesPerColumn = mapSamplesSpinBox->value();
+
+    // Iterate at device resolution over the current axis ranges
+    const QRectF plotArea = chart->plotArea();
+    const qreal dpr = chartView->devicePixelRatioF();
+    const QSize pixels = (plotArea.size() * dpr).toSize();
+    const QRectF world(axisX->min(), axisY->min(), axisX->max() - axisX->min(), axisY->max() - axisY->min());
+
+    // Unchanged inputs keep the last counts, only a new color is drawn again
+    QElapsedTimer timer;
+    timer.start();
+    const bool iterated = iteratedMap.compute(plot.compiled, bindings, world, pixels, settings, previewMathMode());
+    QImage image = iteratedMap.render(plot.color);
+    image.setDevicePixelRatio(dpr);
+    mapLayer->setImage(image, plotArea);
+    if (iterated) {
+        mapInfoLabel->setText(QString("%1: %2 M iterations in %3 ms")
+                                  .arg(plot.name)
+                                  .arg(iteratedMap.evaluations() / 1e6, 0, 'f', 1)
+                                  .arg(timer.elapsed()));
+    }
+}
+
+void PlotterMainWindow::updateDomainColoring(const EquationPlot &plot)
+{
+    const CompiledExpression &expression = domainColoring.expression();
+    if (expression.source() != plot.equation || expression.variables() != plot.compiled.variables() ||
+        !expression.isValid()) {
+        if (!domainColoring.setExpression(plot.equation, parameterNames(plot))) {
+            heatmapLayer->clear();
+            return;
+        }
+    }
+    domainColoring.setParameters(parameterValues(plot));
+
+    // Same device resolution and axis ranges as the heatmap, tiles still in view are reused
+    const QRectF plotArea = chart->plotArea();
+    const qreal dpr = chartView->devicePixelRatioF();
+    const QSize pixels = (plotArea.size() * dpr).toSize();
+    const QRectF world(axisX->min(), axisY->min(), axisX->max() - axisX->min(), axisY->max() - axisY->min());
+
+    QImage image = domainColoring.render(world, pixels);
+    image.setDevicePixelRatio(dpr);
+    heatmapLayer->setImage(image, plotArea);
+}
+
+void PlotterMainWindow::onSweepClicked()
+{
+    int currentRow = currentEquationRow();
+    if (currentRow < 0 || currentRow >= plots.size() || plots[currentRow].type != PlotType::Function) {
+        QMessageBox::warning(this, "No Equation", "Select a function equation to sweep.");
+        return;
+    }
+
+    const EquationPlot &plot = plots[currentRow];
+    const QString name = sweepParameterComboBox->currentText();
+    const int slot = plot.compiled.slotOf(name);
+    if (name.isEmpty() || slot <= 0) {
+        QMessageBox::warning(this, "No Parameter",
+                             "Equation '" + plot.name + "' has no parameter named '" + name + "'.");
+        return;
+    }
+
+    double xMin = xMinSpinBox->value();
+    double xMax = xMaxSpinBox->value();
+    if (xMin >= xMax) {
+        QMessageBox::warning(this, "Invalid Range", "X Min must be less than X Max.");
+        return;
+    }
+    int numPoints = pointsSpinBox->value();
+    double step = (xMax - xMin) / (numPoints - 1);
+
+    // The other parameters keep their slider values
+    ExpressionBindings bindings;
+    bindParameters(plot, bindings);
+
+    QString error;
+    if (!curveFamily.sweep(plot.compiled, slot, bindings, sweepFromSpinBox->value(), sweepToSpinBox->value(),
+                           sweepStepSpinBox->value(), xMin, step, numPoints, &error)) {
+        QMessageBox::warning(this, "Sweep Error", "Cannot sweep '" + plot.name + "': " + error);
+        return;
+    }
+
+    m_sweepName = name;
+    sweepInfoLabel->setText(QString("%1: %2 curves over %3 = %4..%5")
+                                .arg(plot.name).arg(curveFamily.curveCount()).arg(name)
+                                .arg(curveFamily.parameterAt(0))
+                                .arg(curveFamily.parameterAt(curveFamily.curveCount() - 1)));
+    exportSweepButton->setEnabled(true);
+    updateSweepLayer();
+}
+
+void PlotterMainWindow::onClearSweepClicked()
+{
+    curveFamily.clear();
+    sweepLayer->clear();
+    sweepInfoLabel->setText("No sweep");
+    exportSweepButton->setEnabled(false);
+}
+
+void PlotterMainWindow::onExportSweepClicked()
+{
+    if (curveFamily.isEmpty()) {
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Curve Family", "", "CSV File (*.csv)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text) || !curveFamily.writeCsv(&file, m_sweepName)) {
+        QMessageBox::warning(this, "Export Error", "Failed to export the curve family.");
+    }
+}
+
+void PlotterMainWindow::updateSweepLayer()
+{
+    if (curveFamily.isEmpty()) {
+        sweepLayer->clear();
+        return;
+    }
+
+    // Draw at device resolution over the current axis ranges
+    const QRectF plotArea = chart->plotArea();
+    const qreal dpr = chartView->devicePixelRatioF();
+    const QSize pixels = (plotArea.size() * dpr).toSize();
+    const QRectF world(axisX->min(), axisY->min(), axisX->max() - axisX->min(), axisY->max() - axisY->min());
+
+    QImage image = curveFamily.render(world, pixels);
+    image.setDevicePixelRatio(dpr);
+    sweepLayer->setImage(image, plotArea);
+}
+
+void PlotterMainWindow::onClearPlotClicked()
+{
+    // Traces refer to the series that are about to go
+    oscilloscopeTimer->stop();
+    m_oscilloscope.clear();
+    {
+        QSignalBlocker blocker(runTimeButton);
+        runTimeButton->setChecked(false);
+        runTimeButton->setText("Run");
+    }
+    clearFeatures();
+    chart->removeAllSeries();
+    m_heatmapIndex = -1;
+    heatmapLayer->clear();
+    m_mapIndex = -1;
+    mapLayer->clear();
+    iteratedMap.clear();
+    curveLayer->clear();
+    onClearSweepClicked();
+
+    // Reset the series pointers
+    for (EquationPlot &plot : plots) {
+        plot.series = nullptr;
+        plot.derivativeSeries = nullptr;
+        plot.secondDerivativeSeries = nullptr;
+    }
+}
+
+void PlotterMainWindow::onEquationSelectionChanged()
+{
+    int currentRow = currentEquationRow();
+    bool hasSelection = (currentRow >= 0 && currentRow < plots.size());
+
+    // Enable/disable buttons based on selection
+    removeEquationButton->setEnabled(hasSelection);
+    visibilityCheckBox->setEnabled(hasSelection);
+    colorButton->setEnabled(hasSelection);
+    lineWidthSpinBox->setEnabled(hasSelection);
+
+    // Derivatives need the compiled engine, equations on the JavaScript fallback have none
+    const bool canDerive = hasSelection && plots[currentRow].type == PlotType::Function &&
+                           plots[currentRow].compiled.isValid();
+    derivativeCheckBox->setEnabled(canDerive);
+    secondDerivativeCheckBox->setEnabled(canDerive);
+
+    // Update controls based on selection
+    if (hasSelection) {
+        EquationPlot &plot = plots[currentRow];
+
+        // Update visibility checkbox
+        visibilityCheckBox->setChecked(plot.visible);
+
+        // Update color button
+        QString colorStyle = QString("background-color: %1").arg(plot.color.name());
+        colorButton->setStyleSheet(colorStyle);
+
+        // Update line width
+        lineWidthSpinBox->setValue(plot.lineWidth);
+
+        // Update derivative options without triggering a regeneration
+        QSignalBlocker blockFirst(derivativeCheckBox);
+        QSignalBlocker blockSecond(secondDerivativeCheckBox);
+        derivativeCheckBox->setChecked(plot.showDerivative);
+        secondDerivativeCheckBox->setChecked(plot.showSecondDerivative);
+
+        // Initial values of a differential equation are edited in its panel
+        if (plot.type == PlotType::Ode) {
+            initialValuesInput->setText(OdeSolver::formatInitialValues(plot.initialValues));
+        }
+    }
+    updateDiagnosticsLabel();
+}
+
+void PlotterMainWindow::updateDiagnosticsLabel()
+{
+    const int row = currentEquationRow();
+    const QString summary = row >= 0 && row < plots.size() ? plots[row].diagnostics.summary() : QString();
+    diagnosticsLabel->setText(summary);
+    diagnosticsLabel->setVisible(!summary.isEmpty());
+}
+
+void PlotterMainWindow::onEquationVisibilityChanged(int state)
+{
+    int currentRow = currentEquationRow();
+    if (currentRow >= 0 && currentRow < plots.size()) {
+        plots[currentRow].visible = (state == Qt::Checked);
+        onGeneratePlotClicked(); // Update the plot
+    }
+}
+
+void PlotterMainWindow::onEquationColorChanged()
+{
+    int currentRow = currentEquationRow();
+    if (currentRow >= 0 && currentRow < plots.size()) {
+        QColor newColor = QColorDialog::getColor(plots[currentRow].color, this, "Select Equation Color");
+
+        if (newColor.isValid()) {
+            // Update the color
+            plots[currentRow].color = newColor;
+
+            // Update the color button
+            QString colorStyle = QString("background-color: %1").arg(newColor.name());
+            colorButton->setStyleSheet(colorStyle);
+
+            // Update the plot
+            onGeneratePlotClicked();
+        }
+    }
+}
+
+void PlotterMainWindow::onLineWidthChanged(double width)
+{
+    int currentRow = currentEquationRow();
+    if (currentRow >= 0 && currentRow < plots.size()) {
+        plots[currentRow].lineWidth = width;
+        onGeneratePlotClicked(); // Update the plot
+    }
+}
+
+void PlotterMainWindow::onDerivativeOptionsChanged()
+{
+    int currentRow = currentEquationRow();
+    if (currentRow >= 0 && currentRow < plots.size()) {
+        plots[currentRow].showDerivative = derivativeCheckBox->isChecked();
+        plots[currentRow].showSecondDerivative = secondDerivativeCheckBox->isChecked();
+        onGeneratePlotClicked(); // Update the plot
+    }
+}
+
+double PlotterMainWindow::evaluateExpression(const QString &expression, double x, QString *error)
+{
+    // Replace x with its value, whole words only so exp() survives, at full
+    // precision and parenthesized so negative values bind correctly
+    QString jsExpression = expression;
+    static const QRegularExpression variable("\\bx\\b");
+    jsExpression.replace(variable, "(" + QString::number(x, 'g', 17) + ")");
+
+    // The JavaScript engine is only created once an equation needs it, with
+    // support for common mathematical functions and constants
+    if (!m_jsEngine) {
+        m_jsEngine = std::make_unique<QJSEngine>();
+
+        // Define Math library functions
+        m_jsEngine->evaluate(
+            "function sin(x) { return Math.sin(x); }"
+            "function cos(x) { return Math.cos(x); }"
+            "function tan(x) { return Math.tan(x); }"
+            "function sqrt(x) { return Math.sqrt(x); }"
+            "function abs(x) { return Math.abs(x); }"
+            "function log(x) { return Math.log(x); }"  // Natural log
+            "function log10(x) { return Math.log10(x); }"
+            "function exp(x) { return Math.exp(x); }"
+            "function pow(x, y) { return Math.pow(x, y); }"
+            "var pi = Math.PI;"
+            "var e = Math.E;"
+            );
+    }
+
+    // Handle common operations that might not be JS compatible
+    jsExpression.replace("^", "**");  // Replace ^ with ** for exponentiation
+
+    // Evaluate the expression
+    QJSValue result = m_jsEngine->evaluate(jsExpression);
+
+    if (result.isError()) {
+        if (error) {
+            *error = result.toString();
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return result.toNumber();
+}
+
+void PlotterMainWindow::onEquationDoubleClicked(const QModelIndex &index)
+{
+    int row = index.row();
     if (row >= 0 && row < plots.size()) {
         // Get current equation
         EquationPlot &plot = plots[row];
@@ -1056,21 +2957,36 @@ void PlotterMainWindow::onEquationDoubleClicked(QListWidgetItem *item)
                 return;
             }
 
+            EquationPlot check;
+            check.type = plot.type;
+            check.equation = newEquation;
+            QString error;
+            if (!validateEquation(check, &error)) {
+                QMessageBox::warning(this, "Invalid Equation", error);
+                return;
+            }
+
             // Check for duplicate names (except for this equation)
-            for (int i = 0; i < plots.size(); i++) {
-                if (i != row && plots[i].name == newName) {
-                    QMessageBox::warning(this, "Duplicate Name",
-                                         "An equation with this name already exists.");
-                    return;
-                }
+            const int existing = plots.indexOf(newName);
+            if (existing >= 0 && existing != row) {
+                QMessageBox::warning(this, "Duplicate Name",
+                                     "An equation with this name already exists.");
+                return;
             }
 
-            // Update the equation
-            plot.name = newName;
+            // Update the equation, the model renames the list entry.
+            // Curves are keyed by name in the single layer, drop the old ones.
+            removeSeriesOf(plot);
+            plots.rename(row, newName);
             plot.equation = newEquation;
+            plots.equationChanged(row);
+            compileEquation(plot);
+            syncParameters();
 
-            // Update the list item
-            item->setText(newName);
+            // The new equation may have gained or lost its derivatives
+            if (row == currentEquationRow()) {
+                onEquationSelectionChanged();
+            }
 
             // Regenerate the plot
             onGeneratePlotClicked();
@@ -1084,15 +3000,135 @@ void PlotterMainWindow::onSavePlotAsImageClicked()
     QString fileName = QFileDialog::getSaveFileName(this,
                                                     "Save Plot as Image",
                                                     "",
-                                                    "PNG Image (*.png);;JPEG Image (*.jpg *.jpeg)");
+                                                    "PNG Image (*.png);;JPEG Image (*.jpg *.jpeg);;"
+                                                    "SVG Image (*.svg);;PDF Document (*.pdf)");
     if (!fileName.isEmpty()) {
-        // Grab the chart view's current display as a pixmap
-        QPixmap pixmap = chartView->grab();
+        // Exports are exact, redraw fast math previews with libm first
+        m_exporting = true;
+        refinePreviews();
+
+        const QString suffix = QFileInfo(fileName).suffix().toLower();
+        bool saved = false;
+        if (suffix == "svg" || suffix == "pdf") {
+            saved = exportVector(fileName, suffix == "pdf");
+        } else {
+            // Grab the chart view's current display as a pixmap
+            QPixmap pixmap = chartView->grab();
+            saved = pixmap.save(fileName);
+        }
+
+        m_exporting = false;
+        updateHeatmapLayer();
+        updateMapLayer();
 
-        // Attempt to save the pixmap to the chosen file
-        if (!pixmap.save(fileName)) {
+        if (!saved) {
             QMessageBox::warning(this, "Save Error", "Failed to save the image.");
         }
     }
 }
 
+bool PlotterMainWindow::exportVector(const QString &fileName, bool pdf)
+{
+    // The output has the chart's on-screen size, PDF pages at 96 dpi screen size
+    const QRectF source = chart->sceneBoundingRect();
+    std::unique_ptr<QPaintDevice> device;
+    QRectF target;
+    if (pdf) {
+        auto writer = std::make_unique<QPdfWriter>(fileName);
+        writer->setResolution(PdfExportDpi);
+        writer->setPageSize(QPageSize(source.size() * 72.0 / 96.0, QPageSize::Point, QString(), QPageSize::ExactMatch));
+        writer->setPageMargins(QMarginsF(0.0, 0.0, 0.0, 0.0));
+        writer->setTitle(chart->title());
+        target = QRectF(0.0, 0.0, writer->width(), writer->height());
+        device = std::move(writer);
+    } else {
+        auto generator = std::make_unique<QSvgGenerator>();
+        generator->setFileName(fileName);
+        generator->setSize(source.size().toSize());
+        generator->setViewBox(QRectF(QPointF(0.0, 0.0), source.size()));
+        generator->setTitle(chart->title());
+        target = generator->viewBoxF();
+        device = std::move(generator);
+    }
+
+    QPainter painter;
+    if (!painter.begin(device.get())) {
+        return false;
+    }
+
+    // The chart paints its background, axes, labels, legend, markers and image
+    // layers. The curves are taken out and drawn simplified below, a series
+    // keeps its points shared with the saved copy so nothing is duplicated.
+    QList<QPair<QLineSeries *, QList<QPointF>>> lines;
+    for (EquationPlot &plot : plots) {
+        for (QLineSeries *series : { plot.series, plot.derivativeSeries, plot.secondDerivativeSeries }) {
+            if (series) {
+                lines.append({ series, series->points() });
+                series->clear();
+            }
+        }
+    }
+    curveLayer->setCurvesVisible(false);
+    crosshairLayer->hideCursor();
+    chart->scene()->render(&painter, target, source);
+
+    // World to output coordinates through the plot area
+    const double scale = target.width() / source.width();
+    const QRectF area = chart->mapRectToScene(chart->plotArea());
+    const QRectF plotArea(target.left() + (area.left() - source.left()) * scale,
+                          target.top() + (area.top() - source.top()) * scale,
+                          area.width() * scale, area.height() * scale);
+    const double xMin = axisX->min();
+    const double yMin = axisY->min();
+    const double xRange = axisX->max() - xMin;
+    const double yRange = axisY->max() - yMin;
+    auto toOutput = [&](const QPointF &p) {
+        return QPointF(plotArea.left() + (p.x() - xMin) / xRange * plotArea.width(),
+                       plotArea.bottom() - (p.y() - yMin) / yRange * plotArea.height());
+    };
+
+    // Half a dot at the PDF resolution, a quarter pixel for SVG which may be zoomed
+    const double tolerance = pdf ? 0.5 : 0.25;
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setClipRect(plotArea);
+
+    for (const auto &line : lines) {
+        QPen pen = line.first->pen();
+        pen.setWidthF(pen.widthF() * scale);
+        painter.setPen(pen);
+        PolylineStream stream(&painter, tolerance);
+        for (qsizetype i = 0; i < line.second.size(); i++) {
+            if (i == 0) {
+                stream.moveTo(toOutput(line.second[i]));
+            } else {
+                stream.lineTo(toOutput(line.second[i]));
+            }
+        }
+        stream.finish();
+    }
+
+    for (int row = 0; row < curveLayer->curveCount(); row++) {
+        // Layer pens are cosmetic, give them their on-screen width at the output scale
+        QPen pen = curveLayer->curvePen(row);
+        pen.setCosmetic(false);
+        pen.setWidthF(pen.widthF() * scale);
+        painter.setPen(pen);
+        PolylineStream stream(&painter, tolerance);
+        const SegmentedCurve &curve = curveLayer->curvePoints(row);
+        const QPointF *points = curve.points().constData();
+        for (int k = 0; k < curve.segmentCount(); k++) {
+            stream.moveTo(toOutput(points[curve.segmentBegin(k)]));
+            for (int i = curve.segmentBegin(k) + 1; i < curve.segmentEnd(k); i++) {
+                stream.lineTo(toOutput(points[i]));
+            }
+        }
+        stream.finish();
+    }
+
+    for (const auto &line : lines) {
+        line.first->replace(line.second);
+    }
+    curveLayer->setCurvesVisible(true);
+    return painter.end();
+}
+
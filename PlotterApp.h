@@ -8,6 +8,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QListWidget>
+#include <QListView>
 #include <QCheckBox>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
@@ -18,16 +19,41 @@
 #include <QColorDialog>
 #include <QMessageBox>
 #include <QtMath>
-#include <QJSEngine>
+#include <QComboBox>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStackedWidget>
+#include <QHash>
+#include <QSet>
+#include <memory>
 
 // QtCharts includes
 #include <QtCharts/QChartView>
 #include <QtCharts/QChart>
 #include <QtCharts/QLineSeries>
+#include <QtCharts/QScatterSeries>
 #include <QtCharts/QValueAxis>
 
+#include "ChartImageLayer.h"
+#include "CrosshairLayer.h"
+#include "CurveAnalysis.h"
+#include "CurveFamily.h"
+#include "CurveLayer.h"
+#include "EquationModel.h"
+#include "ExpressionEngine.h"
+#include "HeatmapRenderer.h"
+#include "DomainColoring.h"
+#include "IteratedMap.h"
+#include "Oscilloscope.h"
+#include "OdeSolver.h"
+#include "PointIndex.h"
+#include "SessionFile.h"
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class PlotterMainWindow; }
+class QJSEngine;
+class QGridLayout;
+class QSlider;
 QT_END_NAMESPACE
 
 // Resize mode enum for tracking which edge/corner is being dragged
@@ -43,16 +69,17 @@ enum class ResizeMode {
     BottomRight
 };
 
-class EquationPlot {
-public:
+// Free parameter of one or more equations, shared by name and driven by a slider
+struct PlotParameter {
     QString name;
-    QString equation;
-    QColor color;
-    bool visible;
-    double lineWidth;
-    QLineSeries *series;
+    double value = 1.0;
+};
 
-    EquationPlot() : visible(true), lineWidth(2.0), series(nullptr) {}
+// Widgets of one parameter's row in the Parameters group
+struct ParameterRow {
+    QLabel *label = nullptr;
+    QSlider *slider = nullptr;
+    QDoubleSpinBox *valueSpinBox = nullptr;
 };
 
 class PlotterMainWindow : public QMainWindow
@@ -69,6 +96,7 @@ protected:
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void paintEvent(QPaintEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private slots:
     void onAddEquationClicked();
@@ -79,25 +107,131 @@ private slots:
     void onEquationVisibilityChanged(int state);
     void onEquationColorChanged();
     void onLineWidthChanged(double width);
-    void onEquationDoubleClicked(QListWidgetItem *item);
+    void onDerivativeOptionsChanged();
+    void onEquationDoubleClicked(const QModelIndex &index);
+    void onImportEquationsClicked();
+    void onSaveSessionClicked();
+    void onOpenSessionClicked();
     void onSavePlotAsImageClicked();
+    void onFindFeaturesClicked();
+    void onParameterFrame();
+    void onSweepClicked();
+    void onClearSweepClicked();
+    void onExportSweepClicked();
+    void onRunTimeToggled(bool running);
+    void onResetTimeClicked();
+    void onOscilloscopeFrame();
+    void onInitialValuesEdited();
+    void onOdeOptionsChanged();
 
 private:
     void setupUI();
-    double evaluateExpression(const QString &expression, double x);
+    void beginInteraction();
+    void scheduleGeometry();
+    void applyPendingGeometry();
+    void endInteraction();
+    double evaluateExpression(const QString &expression, double x, QString *error = nullptr);
+    static bool compileEquation(EquationPlot &plot, QString *error = nullptr);
+    bool validateEquation(EquationPlot &plot, QString *error);
+    void updateDiagnosticsLabel();
+    static QColor defaultColor(int index);
+    int currentEquationRow() const;
+    void selectEquation(int row);
+    static QStringList baseVariables(PlotType type);
+    static QStringList parameterNames(const EquationPlot &plot);
+    QVector<double> parameterValues(const EquationPlot &plot) const;
+    void bindParameters(const EquationPlot &plot, ExpressionBindings &bindings) const;
+    void syncParameters();
+    ParameterRow createParameterRow(const QString &name, double value);
+    void setParameterValue(const QString &name, double value);
+    int autoPointCount() const;
+    void updateAutoPoints(bool force);
+    MathMode previewMathMode() const;
+    void refinePreviews();
+    void startOscilloscope();
+    void prepareSampleGrid(double xMin, double step, int numPoints);
+    bool generateFunctionPlot(EquationPlot &plot, double xMin, double step, int numPoints,
+                              double yMin, double yMax, SamplePrecision precision, MathMode mathMode);
+    bool generateOdePlot(EquationPlot &plot, double xMin, double xMax, double yMin, double yMax, double step);
+    bool updateCurveSeries(QLineSeries *&series, const QString &name, const QPen &pen,
+                           const SegmentedCurve &curve);
+    void removeCurveSeries(QLineSeries *&series, const QString &name);
+    void removeSeriesOf(EquationPlot &plot);
+    bool isPlotted(const EquationPlot &plot) const;
+    void updateCurveLayer();
+    bool exportVector(const QString &fileName, bool pdf);
+    void updateCrosshair(const QPoint &viewportPos);
+    void applyBackgroundColor(const QColor &color);
+    void applyTextColor(const QColor &color);
+    void enforceCacheBudget();
+    void updateHeatmapLayer();
+    void updateSweepLayer();
+    void updateMapLayer();
+    void updateDomainColoring(const EquationPlot &plot);
+    void clearFeatures();
+    QScatterSeries *addFeatureSeries(const QString &name, const QColor &color, QScatterSeries::MarkerShape shape);
 
     // Main UI components
     QWidget *centralWidget;
 
     // Equation controls
     QLineEdit *equationInput;
+    QComboBox *plotTypeComboBox;
     QLineEdit *equationNameInput;
     QPushButton *addEquationButton;
     QPushButton *removeEquationButton;
-    QListWidget *equationsList;
+    QListView *equationsList;
+    QPushButton *importEquationsButton;
+    QPushButton *saveSessionButton;
+    QPushButton *openSessionButton;
     QCheckBox *visibilityCheckBox;
     QPushButton *colorButton;
     QDoubleSpinBox *lineWidthSpinBox;
+    QCheckBox *derivativeCheckBox;
+    QCheckBox *secondDerivativeCheckBox;
+    QLabel *diagnosticsLabel;
+
+    // Parameter sliders
+    static constexpr int ParameterSliderSteps = 100;
+    QGroupBox *parametersGroup;
+    QGridLayout *parametersGrid;
+    QTimer *parameterTimer;
+    QList<PlotParameter> parameters;
+    // Position of each parameter in parameters, and its slider row
+    QHash<QString, int> m_parameterIndex;
+    QHash<QString, ParameterRow> m_parameterRows;
+    QSet<QString> m_dirtyParameters;
+
+    // Parameter sweep
+    QComboBox *sweepParameterComboBox;
+    QDoubleSpinBox *sweepFromSpinBox;
+    QDoubleSpinBox *sweepToSpinBox;
+    QDoubleSpinBox *sweepStepSpinBox;
+    QPushButton *sweepButton;
+    QPushButton *clearSweepButton;
+    QPushButton *exportSweepButton;
+    QLabel *sweepInfoLabel;
+
+    // Oscilloscope mode
+    QPushButton *runTimeButton;
+    QPushButton *resetTimeButton;
+    QDoubleSpinBox *timeSpeedSpinBox;
+    QLabel *timeInfoLabel;
+    QTimer *oscilloscopeTimer;
+    Oscilloscope m_oscilloscope;
+    QElapsedTimer m_timeClock;
+    QElapsedTimer m_frameClock;
+    double m_time = 0.0;
+    double m_timeOrigin = 0.0;
+    quint64 m_presentedFrames = 0;
+
+    // Differential equations
+    QLineEdit *initialValuesInput;
+    QSpinBox *odeToleranceSpinBox;
+    QCheckBox *directionFieldCheckBox;
+    QLabel *odeInfoLabel;
+    // Direction field grid spacing in pixels, segments take 70% of a cell
+    static constexpr int DirectionFieldCell = 28;
 
     // Plot controls
     QDoubleSpinBox *xMinSpinBox;
@@ -105,24 +239,76 @@ private:
     QDoubleSpinBox *yMinSpinBox;
     QDoubleSpinBox *yMaxSpinBox;
     QSpinBox *pointsSpinBox;
+    QCheckBox *autoPointsCheckBox;
+    QDoubleSpinBox *oversamplingSpinBox;
+    // Relative change of the auto point count that triggers re-sampling
+    static constexpr double AutoPointsThreshold = 0.1;
+    QComboBox *precisionComboBox;
+    QSpinBox *cacheBudgetSpinBox;
+    QLabel *cacheMemoryLabel;
+    QCheckBox *fastMathCheckBox;
+    QCheckBox *jitCheckBox;
+    bool m_exporting = false;
     QPushButton *generatePlotButton;
     QPushButton *clearPlotButton;
+    QLabel *allocationLabel;
 
     // Chart components
     QChartView *chartView;
+    QStackedWidget *chartStack;
+    QLabel *chartSnapshot;
     QChart *chart;
     QValueAxis *axisX;
     QValueAxis *axisY;
+    ChartImageLayer *heatmapLayer;
+    HeatmapRenderer heatmapRenderer;
+    DomainColoring domainColoring;
+    ChartImageLayer *sweepLayer;
+    CurveLayer *curveLayer;
+    CrosshairLayer *crosshairLayer;
+    QCheckBox *singleLayerCheckBox;
+    CurveFamily curveFamily;
+    QString m_sweepName;
+    int m_heatmapIndex = -1;
+
+    // Bifurcation diagram of the topmost visible iterated map
+    ChartImageLayer *mapLayer;
+    IteratedMap iteratedMap;
+    int m_mapIndex = -1;
+    QDoubleSpinBox *mapStartSpinBox;
+    QSpinBox *mapTransientSpinBox;
+    QSpinBox *mapIterationsSpinBox;
+    QSpinBox *mapSamplesSpinBox;
+    QLabel *mapInfoLabel;
 
     // Data storage
-    QList<EquationPlot> plots;
+    EquationModel plots;
+    SampleBuffer sampleXs;
+    SampleBuffer sampleValues;
+    SampleBuffer sampleDerivatives;
+    SampleBuffer secondDerivativeScratch;
+    SampleBuffer envelopeXs;
+    SampleBuffer envelopeYs;
+    SegmentedCurve curveSegments;
+    quint64 m_generation = 0;
 
     // Additional UI components
     QPushButton *bgColorButton;
     QLineEdit *plotTitleInput;
     QPushButton *textColorButton;
-    QJSEngine jsEngine;
+    // Fallback evaluator for equations the engine can't compile, created on first use
+    std::unique_ptr<QJSEngine> m_jsEngine;
     QPushButton *saveImageButton;
+    static constexpr int PdfExportDpi = 300;
+
+    // Root, extremum and intersection finder
+    QPushButton *findFeaturesButton;
+    QListWidget *featuresList;
+    QScatterSeries *rootMarkers = nullptr;
+    QScatterSeries *extremaMarkers = nullptr;
+    QScatterSeries *intersectionMarkers = nullptr;
+    PointIndex featureIndex;
+    QStringList featureLabels;
 
     // Custom title bar and resize handling
     bool m_dragging = false;
@@ -131,6 +317,8 @@ private:
     QPoint m_resizeStartPos;
     QRect m_initialRect;
     ResizeMode m_resizeMode = ResizeMode::None;
+    QRect m_pendingGeometry;
+    QTimer *geometryTimer;
 };
 
 class CustomDialog : public QDialog
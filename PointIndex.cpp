@@ -0,0 +1,123 @@
+#include "PointIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void PointIndex::build(const QVector<QPointF> &points)
+{
+    clear();
+
+    // Bounds of the finite points, the others can never be hovered
+    double left = std::numeric_limits<double>::infinity();
+    double right = -left;
+    double top = left;
+    double bottom = -left;
+    int finite = 0;
+    for (const QPointF &p : points) {
+        if (!std::isfinite(p.x()) || !std::isfinite(p.y()))
+            continue;
+        left = std::min(left, p.x());
+        right = std::max(right, p.x());
+        top = std::min(top, p.y());
+        bottom = std::max(bottom, p.y());
+        finite++;
+    }
+    m_slots.fill(-1, points.size());
+    if (finite == 0)
+        return;
+
+    // Cells follow the aspect of the bounds, degenerate axes get one cell
+    m_bounds = QRectF(left, top, right - left, bottom - top);
+    const double cells = std::max(1.0, double(finite) / PointsPerCell);
+    if (m_bounds.width() <= 0.0 || m_bounds.height() <= 0.0) {
+        const int line = int(std::min(cells, 65536.0));
+        m_columns = m_bounds.width() > 0.0 ? line : 1;
+        m_rows = m_bounds.height() > 0.0 ? line : 1;
+    } else {
+        const double aspect = m_bounds.width() / m_bounds.height();
+        m_columns = int(std::clamp(std::sqrt(cells * aspect), 1.0, 65536.0));
+        m_rows = int(std::clamp(cells / m_columns, 1.0, 65536.0));
+    }
+
+    // Counting sort of the points by cell
+    QVector<int> cellOf(points.size(), -1);
+    m_cellStart.fill(0, m_columns * m_rows + 1);
+    for (int i = 0; i < points.size(); i++) {
+        const QPointF &p = points[i];
+        if (!std::isfinite(p.x()) || !std::isfinite(p.y()))
+            continue;
+        cellOf[i] = row(p.y()) * m_columns + column(p.x());
+        m_cellStart[cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < m_columns * m_rows; c++)
+        m_cellStart[c + 1] += m_cellStart[c];
+
+    QVector<int> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_points.resize(finite);
+    m_ids.resize(finite);
+    for (int i = 0; i < points.size(); i++) {
+        if (cellOf[i] < 0)
+            continue;
+        const int slot = fill[cellOf[i]]++;
+        m_points[slot] = points[i];
+        m_ids[slot] = i;
+        m_slots[i] = slot;
+    }
+}
+
+void PointIndex::clear()
+{
+    m_bounds = QRectF();
+    m_columns = 0;
+    m_rows = 0;
+    m_points.clear();
+    m_ids.clear();
+    m_slots.clear();
+    m_cellStart.clear();
+}
+
+int PointIndex::column(double x) const
+{
+    if (m_bounds.width() <= 0.0)
+        return 0;
+    return std::clamp(int((x - m_bounds.left()) / m_bounds.width() * m_columns), 0, m_columns - 1);
+}
+
+int PointIndex::row(double y) const
+{
+    if (m_bounds.height() <= 0.0)
+        return 0;
+    return std::clamp(int((y - m_bounds.top()) / m_bounds.height() * m_rows), 0, m_rows - 1);
+}
+
+int PointIndex::nearest(const QPointF &p, const QSizeF &radius) const
+{
+    if (m_points.isEmpty() || radius.width() <= 0.0 || radius.height() <= 0.0)
+        return -1;
+
+    // Search box outside the bounds, nothing to find
+    if (p.x() + radius.width() < m_bounds.left() || p.x() - radius.width() > m_bounds.right() ||
+        p.y() + radius.height() < m_bounds.top() || p.y() - radius.height() > m_bounds.bottom())
+        return -1;
+
+    const int firstColumn = column(p.x() - radius.width());
+    const int lastColumn = column(p.x() + radius.width());
+    const int firstRow = row(p.y() - radius.height());
+    const int lastRow = row(p.y() + radius.height());
+
+    int best = -1;
+    double bestDistance = 1.0;
+    for (int r = firstRow; r <= lastRow; r++) {
+        const int cell = r * m_columns;
+        for (int slot = m_cellStart[cell + firstColumn]; slot < m_cellStart[cell + lastColumn + 1]; slot++) {
+            const double dx = (m_points[slot].x() - p.x()) / radius.width();
+            const double dy = (m_points[slot].y() - p.y()) / radius.height();
+            const double distance = dx * dx + dy * dy;
+            if (distance <= bestDistance) {
+                bestDistance = distance;
+                best = m_ids[slot];
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,44 @@
+// PointIndex.h
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QVector>
+
+// Uniform grid over a fixed set of scattered points, for nearest-point lookups
+// under the cursor where the points aren't a function of x (feature markers,
+// trajectories, bifurcation diagrams). Points are bucketed by a counting sort,
+// so building is O(n) and a query only visits the cells overlapping its box.
+class PointIndex
+{
+public:
+    // Average points per cell
+    static constexpr int PointsPerCell = 4;
+
+    void build(const QVector<QPointF> &points);
+    void clear();
+
+    bool isEmpty() const { return m_points.isEmpty(); }
+    int count() const { return int(m_points.size()); }
+
+    // Index in the build order of the point nearest to p within p ± radius,
+    // distances are measured in units of radius per axis. -1 if there is none.
+    int nearest(const QPointF &p, const QSizeF &radius) const;
+    QPointF at(int index) const { return m_points[m_slots[index]]; }
+
+private:
+    int column(double x) const;
+    int row(double y) const;
+
+    QRectF m_bounds;
+    int m_columns = 0;
+    int m_rows = 0;
+    QVector<QPointF> m_points;   // grouped by cell
+    QVector<int> m_ids;          // build index of each grouped point
+    QVector<int> m_slots;        // grouped position of each build index
+    QVector<int> m_cellStart;    // first grouped point of each cell, plus the end
+};
+
+#endif
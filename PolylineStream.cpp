@@ -0,0 +1,121 @@
+#include "PolylineStream.h"
+#include <QPainter>
+
+namespace {
+
+// Squared distance from p to the segment a-b
+double segmentDistance2(const QPointF &p, const QPointF &a, const QPointF &b)
+{
+    const QPointF ab = b - a;
+    const QPointF ap = p - a;
+    const double length2 = QPointF::dotProduct(ab, ab);
+    double t = length2 > 0.0 ? QPointF::dotProduct(ap, ab) / length2 : 0.0;
+    t = qBound(0.0, t, 1.0);
+    const QPointF d = ap - t * ab;
+    return QPointF::dotProduct(d, d);
+}
+
+} // namespace
+
+PolylineStream::PolylineStream(QPainter *painter, double tolerance)
+    : m_painter(painter), m_tolerance(tolerance)
+{
+    m_window.reserve(Window);
+    m_kept.reserve(Window);
+}
+
+void PolylineStream::moveTo(const QPointF &point)
+{
+    finish();
+    m_window.append(point);
+    m_input++;
+}
+
+void PolylineStream::lineTo(const QPointF &point)
+{
+    if (m_window.isEmpty()) {
+        moveTo(point);
+        return;
+    }
+    m_input++;
+
+    // Radial pass, points this close to the last kept one can't change the
+    // drawing; the last of a run is remembered so the polyline still ends
+    // where it should. Each pass takes half the tolerance, so together they
+    // stay within it.
+    const QPointF d = point - m_window.last();
+    if (QPointF::dotProduct(d, d) < 0.25 * m_tolerance * m_tolerance) {
+        m_skipped = point;
+        m_hasSkipped = true;
+        return;
+    }
+    m_hasSkipped = false;
+    m_window.append(point);
+    if (m_window.size() >= Window)
+        flush();
+}
+
+void PolylineStream::finish()
+{
+    if (m_window.isEmpty())
+        return;
+    if (m_hasSkipped)
+        m_window.append(m_skipped);
+    m_hasSkipped = false;
+
+    // A lone point is drawn as a dot, unless it only continues a flushed window
+    if (m_window.size() > 1) {
+        flush();
+    } else if (!m_flushed) {
+        m_painter->drawPoint(m_window.first());
+        m_output++;
+    }
+    m_window.clear();
+    m_flushed = false;
+}
+
+void PolylineStream::flush()
+{
+    const int count = int(m_window.size());
+    if (count < 2)
+        return;
+
+    // Douglas-Peucker with an explicit stack of index pairs
+    const double tolerance2 = 0.25 * m_tolerance * m_tolerance;
+    m_keep.fill(0, count);
+    m_keep[0] = 1;
+    m_keep[count - 1] = 1;
+    m_stack.clear();
+    m_stack << 0 << count - 1;
+    while (!m_stack.isEmpty()) {
+        const int last = m_stack.takeLast();
+        const int first = m_stack.takeLast();
+        double farthest = 0.0;
+        int index = -1;
+        for (int i = first + 1; i < last; i++) {
+            const double distance = segmentDistance2(m_window[i], m_window[first], m_window[last]);
+            if (distance > farthest) {
+                farthest = distance;
+                index = i;
+            }
+        }
+        if (index >= 0 && farthest > tolerance2) {
+            m_keep[index] = 1;
+            m_stack << first << index << index << last;
+        }
+    }
+
+    m_kept.clear();
+    for (int i = 0; i < count; i++) {
+        if (m_keep[i])
+            m_kept.append(m_window[i]);
+    }
+    m_painter->drawPolyline(m_kept.constData(), int(m_kept.size()));
+    m_output += m_kept.size();
+
+    // The next window continues from the last point drawn
+    const QPointF end = m_window.last();
+    m_window.clear();
+    m_window.append(end);
+    m_flushed = true;
+}
@@ -0,0 +1,50 @@
+// PolylineStream.h
+#ifndef POLYLINESTREAM_H
+#define POLYLINESTREAM_H
+
+#include <QPointF>
+#include <QVector>
+
+class QPainter;
+
+// Draws polylines through a QPainter simplified to a tolerance in device
+// units, for vector exports where every point becomes file content. Points
+// are pushed one at a time: those within the tolerance of the last kept point
+// are dropped on the fly, the rest collect in a bounded window that is
+// simplified with Douglas-Peucker and drawn whenever it fills. Memory stays
+// O(Window) however long the curve is, and the output only holds the points
+// that are visible at the output resolution.
+class PolylineStream
+{
+public:
+    static constexpr int Window = 4096;
+
+    PolylineStream(QPainter *painter, double tolerance);
+
+    // Start a new polyline, ending the current one
+    void moveTo(const QPointF &point);
+    void lineTo(const QPointF &point);
+
+    // Draw whatever is still buffered
+    void finish();
+
+    qint64 inputPoints() const { return m_input; }
+    qint64 outputPoints() const { return m_output; }
+
+private:
+    void flush();
+
+    QPainter *m_painter;
+    double m_tolerance;
+    QVector<QPointF> m_window;
+    QVector<int> m_stack;
+    QVector<char> m_keep;
+    QVector<QPointF> m_kept;
+    QPointF m_skipped;
+    bool m_hasSkipped = false;
+    bool m_flushed = false;
+    qint64 m_input = 0;
+    qint64 m_output = 0;
+};
+
+#endif
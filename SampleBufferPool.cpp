@@ -0,0 +1,107 @@
+#include "SampleBufferPool.h"
+#include "Arena.h"
+#include <QMutexLocker>
+#include <cstdlib>
+#include <new>
+
+SampleBufferPool &SampleBufferPool::instance()
+{
+    static SampleBufferPool pool;
+    return pool;
+}
+
+SampleBufferPool::~SampleBufferPool()
+{
+    for (std::vector<void *> &list : m_free) {
+        for (void *data : list)
+            std::free(data);
+    }
+}
+
+int SampleBufferPool::sizeClass(qsizetype bytes)
+{
+    int shift = MinClassShift;
+    while (shift < MinClassShift + NumClasses - 1 && (qsizetype(1) << shift) < bytes)
+        shift++;
+    return shift - MinClassShift;
+}
+
+void *SampleBufferPool::acquire(qsizetype bytes, qsizetype *capacity)
+{
+    const int cls = sizeClass(bytes);
+    const qsizetype classSize = qsizetype(1) << (cls + MinClassShift);
+
+    // Requests beyond the largest class are served directly
+    if (bytes > classSize) {
+        *capacity = bytes;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_live++;
+        }
+        HotPathAllocations::add();
+        void *data = std::malloc(bytes);
+        if (!data)
+            throw std::bad_alloc();
+        return data;
+    }
+
+    *capacity = classSize;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_live++;
+        if (!m_free[cls].empty()) {
+            void *data = m_free[cls].back();
+            m_free[cls].pop_back();
+            m_cachedBytes -= classSize;
+            return data;
+        }
+    }
+
+    HotPathAllocations::add();
+    void *data = std::malloc(classSize);
+    if (!data)
+        throw std::bad_alloc();
+    return data;
+}
+
+void SampleBufferPool::release(void *data, qsizetype capacity)
+{
+    if (!data)
+        return;
+
+    const int cls = sizeClass(capacity);
+    QMutexLocker locker(&m_mutex);
+    m_live--;
+    if (capacity != (qsizetype(1) << (cls + MinClassShift))) {
+        std::free(data);
+        return;
+    }
+
+    m_free[cls].push_back(data);
+    m_cachedBytes += capacity;
+}
+
+void SampleBufferPool::trim(qsizetype keepBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int cls = NumClasses - 1; cls >= 0 && m_cachedBytes > keepBytes; cls--) {
+        const qsizetype classSize = qsizetype(1) << (cls + MinClassShift);
+        while (!m_free[cls].empty() && m_cachedBytes > keepBytes) {
+            std::free(m_free[cls].back());
+            m_free[cls].pop_back();
+            m_cachedBytes -= classSize;
+        }
+    }
+}
+
+qsizetype SampleBufferPool::cachedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cachedBytes;
+}
+
+qsizetype SampleBufferPool::liveBuffers() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_live;
+}
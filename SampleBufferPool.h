@@ -0,0 +1,128 @@
+// SampleBufferPool.h
+#ifndef SAMPLEBUFFERPOOL_H
+#define SAMPLEBUFFERPOOL_H
+
+#include <QMutex>
+#include <QtGlobal>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Size-classed pool of raw blocks for samples that live across regenerations.
+// Capacities are powers of two, so a buffer released by one equation can be
+// picked up by any other of a similar size next time.
+class SampleBufferPool
+{
+public:
+    static constexpr int MinClassShift = 13;   // 8 KB
+    static constexpr int NumClasses = 20;      // up to 4 GB
+
+    static SampleBufferPool &instance();
+
+    // Returns a block of at least bytes, its real size in capacity
+    void *acquire(qsizetype bytes, qsizetype *capacity);
+    // Takes back a block with the capacity acquire returned for it
+    void release(void *data, qsizetype capacity);
+
+    // Return free blocks to the heap until at most keepBytes stay cached
+    void trim(qsizetype keepBytes);
+
+    qsizetype cachedBytes() const;
+    qsizetype liveBuffers() const;
+
+private:
+    SampleBufferPool() = default;
+    ~SampleBufferPool();
+
+    static int sizeClass(qsizetype bytes);
+
+    mutable QMutex m_mutex;
+    std::vector<void *> m_free[NumClasses];
+    qsizetype m_cachedBytes = 0;
+    qsizetype m_live = 0;
+};
+
+// Growable array backed by the pool. Memory goes back to the pool when the
+// buffer is cleared or destroyed, not to the heap.
+template <typename T>
+class PooledBuffer
+{
+public:
+    PooledBuffer() = default;
+    explicit PooledBuffer(qsizetype size) { resize(size); }
+    PooledBuffer(const PooledBuffer &other) { *this = other; }
+    PooledBuffer(PooledBuffer &&other) noexcept { swap(other); }
+    ~PooledBuffer() { clear(); }
+
+    PooledBuffer &operator=(const PooledBuffer &other)
+    {
+        if (this != &other) {
+            resize(other.m_size);
+            std::copy_n(other.m_data, other.m_size, m_data);
+        }
+        return *this;
+    }
+
+    PooledBuffer &operator=(PooledBuffer &&other) noexcept
+    {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    // Contents are preserved up to the smaller of the old and new size
+    void resize(qsizetype size)
+    {
+        if (size <= capacity()) {
+            m_size = size;
+            return;
+        }
+
+        qsizetype bytes = 0;
+        T *data = static_cast<T *>(SampleBufferPool::instance().acquire(size * qsizetype(sizeof(T)), &bytes));
+        std::copy_n(m_data, m_size, data);
+        SampleBufferPool::instance().release(m_data, m_bytes);
+        m_data = data;
+        m_size = size;
+        m_bytes = bytes;
+    }
+
+    void clear()
+    {
+        SampleBufferPool::instance().release(m_data, m_bytes);
+        m_data = nullptr;
+        m_size = 0;
+        m_bytes = 0;
+    }
+
+    void swap(PooledBuffer &other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_bytes, other.m_bytes);
+    }
+
+    qsizetype size() const { return m_size; }
+    qsizetype capacity() const { return m_bytes / qsizetype(sizeof(T)); }
+    qsizetype reservedBytes() const { return m_bytes; }
+    bool isEmpty() const { return m_size == 0; }
+
+    T *data() { return m_data; }
+    const T *data() const { return m_data; }
+    const T *constData() const { return m_data; }
+    T &operator[](qsizetype i) { return m_data[i]; }
+    T operator[](qsizetype i) const { return m_data[i]; }
+
+private:
+    T *m_data = nullptr;
+    qsizetype m_size = 0;
+    // Size of the block as the pool handed it out, kept in bytes so it goes
+    // back to the right class whatever sizeof(T) is
+    qsizetype m_bytes = 0;
+};
+
+using SampleBuffer = PooledBuffer<double>;
+
+#endif
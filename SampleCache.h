@@ -0,0 +1,162 @@
+// SampleCache.h
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include <QString>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "ExpressionEngine.h"
+#include "SampleBufferPool.h"
+#include "SamplePyramid.h"
+
+// Storage precision of cached samples
+enum class SamplePrecision {
+    Double,   // 8 bytes per sample
+    Float     // 4 bytes per sample, plenty below pixel resolution
+};
+
+// One array of cached values, stored as double or float32. Values are always
+// written and read as doubles, conversion happens at the boundary.
+class SampleChannel
+{
+public:
+    void store(const double *values, int count, SamplePrecision precision)
+    {
+        m_precision = precision;
+        if (precision == SamplePrecision::Float) {
+            m_double.clear();
+            m_float.resize(count);
+            float *dst = m_float.data();
+            for (int i = 0; i < count; i++)
+                dst[i] = float(values[i]);
+        } else {
+            m_float.clear();
+            m_double.resize(count);
+            std::copy_n(values, count, m_double.data());
+        }
+    }
+
+    void load(double *out, int first, int count) const
+    {
+        if (m_precision == SamplePrecision::Float)
+            std::copy_n(m_float.constData() + first, count, out);
+        else
+            std::copy_n(m_double.constData() + first, count, out);
+    }
+
+    // Copy values that are already in the given storage precision, e.g. read back from a file
+    void assign(const void *data, int count, SamplePrecision precision)
+    {
+        m_precision = precision;
+        if (precision == SamplePrecision::Float) {
+            m_double.clear();
+            m_float.resize(count);
+            std::memcpy(m_float.data(), data, count * sizeof(float));
+        } else {
+            m_float.clear();
+            m_double.resize(count);
+            std::memcpy(m_double.data(), data, count * sizeof(double));
+        }
+    }
+
+    // The stored values as they are laid out in memory, rawBytes() long
+    const void *rawData() const
+    {
+        return m_precision == SamplePrecision::Float ? static_cast<const void *>(m_float.constData())
+                                                     : static_cast<const void *>(m_double.constData());
+    }
+    qsizetype rawBytes() const
+    {
+        return qsizetype(count()) * (m_precision == SamplePrecision::Float ? sizeof(float) : sizeof(double));
+    }
+
+    double at(int i) const { return m_precision == SamplePrecision::Float ? double(m_float[i]) : m_double[i]; }
+
+    // Direct access when stored as double, null otherwise
+    const double *doubleData() const { return m_precision == SamplePrecision::Double ? m_double.constData() : nullptr; }
+
+    int count() const { return int(m_precision == SamplePrecision::Float ? m_float.size() : m_double.size()); }
+    bool isEmpty() const { return count() == 0; }
+    SamplePrecision precision() const { return m_precision; }
+    qsizetype reservedBytes() const { return m_double.reservedBytes() + m_float.reservedBytes(); }
+
+    void clear()
+    {
+        m_double.clear();
+        m_float.clear();
+    }
+
+private:
+    SamplePrecision m_precision = SamplePrecision::Double;
+    PooledBuffer<double> m_double;
+    PooledBuffer<float> m_float;
+};
+
+// Samples of y = f(x) on a uniform grid from the last regeneration. x is
+// implicit (xMin + i * step) and never stored, dy holds f'(x) when derivatives
+// were sampled. Channels come from the sample pool and are reused across
+// regenerations; equation and parameters record which source and parameter
+// values the samples belong to, mathMode whether they are preview quality.
+// pyramid holds min/max envelopes of y for drawing coarser grids.
+struct SampleCache {
+    QString equation;
+    QVector<double> parameters;
+    MathMode mathMode = MathMode::Exact;
+    double xMin = 0.0;
+    double step = 0.0;
+    SampleChannel y;
+    SampleChannel dy;
+    SamplePyramid pyramid;
+
+    int count() const { return y.count(); }
+    bool isEmpty() const { return y.isEmpty(); }
+    double xAt(int i) const { return xMin + i * step; }
+
+    // y at x interpolated linearly between the samples around it, NaN outside the sampled range
+    double interpolate(double x) const {
+        const int last = count() - 1;
+        const double t = (x - xMin) / step;
+        if (last < 1 || !(t >= 0.0 && t <= last))
+            return std::numeric_limits<double>::quiet_NaN();
+        const int k = std::min(int(t), last - 1);
+        return y.at(k) + (y.at(k + 1) - y.at(k)) * (t - k);
+    }
+    qsizetype reservedBytes() const { return y.reservedBytes() + dy.reservedBytes() + pyramid.reservedBytes(); }
+
+    bool sameGrid(const SampleCache &other) const {
+        return xMin == other.xMin && step == other.step && count() == other.count();
+    }
+
+    // Whether these samples can be reused for the given source and grid. Exact
+    // samples serve fast requests too, fast samples never serve exact ones.
+    bool matches(const QString &source, const QVector<double> &values, double first, double spacing, int points,
+                 SamplePrecision precision, MathMode mode) const {
+        return !isEmpty() && equation == source && parameters == values && xMin == first && step == spacing &&
+               count() == points && y.precision() == precision &&
+               (mode == MathMode::Fast || mathMode == MathMode::Exact);
+    }
+
+    // Whether a grid inside the sampled range can be drawn from the pyramid
+    // instead of evaluating it. Columns need at least two samples each, closer
+    // to the base resolution the envelope would show as steps.
+    bool covers(const QString &source, const QVector<double> &values, double first, double spacing, int points,
+                MathMode mode) const {
+        const double tolerance = 1e-9 * step;
+        return !pyramid.isEmpty() && equation == source && parameters == values && spacing >= 2.0 * step &&
+               first >= xMin - tolerance && first + (points - 1) * spacing <= xAt(count() - 1) + tolerance &&
+               (mode == MathMode::Fast || mathMode == MathMode::Exact);
+    }
+
+    void clear() {
+        equation.clear();
+        parameters.clear();
+        mathMode = MathMode::Exact;
+        y.clear();
+        dy.clear();
+        pyramid.clear();
+    }
+};
+
+#endif
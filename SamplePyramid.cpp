@@ -0,0 +1,137 @@
+#include "SamplePyramid.h"
+#include "SampleCache.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void SamplePyramid::build(const SampleChannel &samples)
+{
+    clear();
+    const int count = samples.count();
+    if ((count >> FirstShift) == 0)
+        return;
+
+    // Bucket counts halve from level to level, partial buckets at the end are
+    // never needed since range() only takes buckets that lie inside its span
+    int total = 0;
+    for (int buckets = count >> FirstShift; buckets > 0; buckets >>= 1) {
+        m_levelStart.append(total);
+        total += buckets;
+    }
+    m_min.resize(total);
+    m_max.resize(total);
+    float *mins = m_min.data();
+    float *maxs = m_max.data();
+
+    const int bucket = 1 << FirstShift;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int b = 0; b < (count >> FirstShift); b++) {
+        double lo = std::numeric_limits<double>::infinity();
+        double hi = -lo;
+        bool finite = true;
+        for (int i = b * bucket; i < (b + 1) * bucket; i++) {
+            const double v = samples.at(i);
+            finite = finite && std::isfinite(v);
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        mins[b] = finite ? float(lo) : nan;
+        maxs[b] = finite ? float(hi) : nan;
+    }
+
+    for (int level = 1; level < m_levelStart.size(); level++) {
+        const int from = m_levelStart[level - 1];
+        const int to = m_levelStart[level];
+        const int buckets = (level + 1 < m_levelStart.size() ? m_levelStart[level + 1] : total) - to;
+        for (int b = 0; b < buckets; b++) {
+            const float *lo = mins + from + 2 * b;
+            const float *hi = maxs + from + 2 * b;
+            const bool finite = !std::isnan(lo[0]) && !std::isnan(lo[1]);
+            mins[to + b] = finite ? std::min(lo[0], lo[1]) : nan;
+            maxs[to + b] = finite ? std::max(hi[0], hi[1]) : nan;
+        }
+    }
+}
+
+void SamplePyramid::clear()
+{
+    m_min.clear();
+    m_max.clear();
+    m_levelStart.clear();
+}
+
+bool SamplePyramid::range(const SampleChannel &samples, int first, int last, double &lo, double &hi) const
+{
+    lo = std::numeric_limits<double>::infinity();
+    hi = -lo;
+
+    // Split the span into the largest aligned buckets that fit, at most two
+    // per level, with single samples at the ragged ends
+    const int levels = int(m_levelStart.size());
+    int i = first;
+    while (i < last) {
+        int shift = FirstShift - 1;
+        while (shift + 1 - FirstShift < levels && (i & ((2 << shift) - 1)) == 0 && i + (2 << shift) <= last)
+            shift++;
+
+        double low;
+        double high;
+        if (shift < FirstShift) {
+            low = high = samples.at(i);
+            if (!std::isfinite(low))
+                return false;
+            i++;
+        } else {
+            const int b = m_levelStart[shift - FirstShift] + (i >> shift);
+            if (std::isnan(m_min[b]))
+                return false;
+            low = m_min[b];
+            high = m_max[b];
+            i += 1 << shift;
+        }
+        lo = std::min(lo, low);
+        hi = std::max(hi, high);
+    }
+    return first < last;
+}
+
+int SamplePyramid::envelope(const SampleChannel &samples, double baseXMin, double baseStep,
+                            double xMin, double step, int columns, double *xs, double *ys) const
+{
+    const int count = samples.count();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    // Column edges are computed once and shared by both neighbours, so rounding
+    // can't drop or duplicate the sample on an edge
+    auto edge = [&](int j) {
+        const double index = std::ceil((xMin + (j - 0.5) * step - baseXMin) / baseStep);
+        return int(std::clamp(index, 0.0, double(count)));
+    };
+
+    double previous = nan;
+    int first = edge(0);
+    for (int j = 0; j < columns; j++) {
+        const int last = edge(j + 1);
+        const double x = xMin + j * step;
+        xs[2 * j] = x;
+        xs[2 * j + 1] = x;
+
+        double lo;
+        double hi;
+        if (!range(samples, first, std::max(last, std::min(first + 1, count)), lo, hi)) {
+            ys[2 * j] = nan;
+            ys[2 * j + 1] = nan;
+            previous = nan;
+        } else if (std::isnan(previous) || std::fabs(previous - lo) <= std::fabs(previous - hi)) {
+            ys[2 * j] = lo;
+            ys[2 * j + 1] = hi;
+            previous = hi;
+        } else {
+            ys[2 * j] = hi;
+            ys[2 * j + 1] = lo;
+            previous = lo;
+        }
+        first = last;
+    }
+    return 2 * columns;
+}
@@ -0,0 +1,44 @@
+// SamplePyramid.h
+#ifndef SAMPLEPYRAMID_H
+#define SAMPLEPYRAMID_H
+
+#include <QVector>
+#include "SampleBufferPool.h"
+
+class SampleChannel;
+
+// Min/max envelopes of a sample channel at power-of-two bucket sizes, like the
+// mip levels of a texture. Built once after sampling, it lets any coarser grid
+// inside the sampled range be drawn from the cached samples in O(columns log n)
+// without evaluating the expression again. Levels start at buckets of
+// 2^FirstShift samples, narrower spans read the samples themselves. Buckets are
+// stored as floats, plenty for an envelope that is only ever drawn.
+class SamplePyramid
+{
+public:
+    static constexpr int FirstShift = 2;
+
+    void build(const SampleChannel &samples);
+    void clear();
+
+    bool isEmpty() const { return m_levelStart.isEmpty(); }
+    qsizetype reservedBytes() const { return m_min.reservedBytes() + m_max.reservedBytes(); }
+
+    // Envelope of samples [first, last) in lo and hi, false when any of them
+    // is not finite
+    bool range(const SampleChannel &samples, int first, int last, double &lo, double &hi) const;
+
+    // Draw the samples taken at baseXMin + i * baseStep onto columns of width
+    // step centred on xMin + j * step. Each column gives two points, its min
+    // and max in the order that continues the previous column, or NaN where the
+    // column holds a gap. Returns the number of points written, 2 * columns.
+    int envelope(const SampleChannel &samples, double baseXMin, double baseStep,
+                 double xMin, double step, int columns, double *xs, double *ys) const;
+
+private:
+    PooledBuffer<float> m_min;   // all levels back to back, NaN marks a gap
+    PooledBuffer<float> m_max;
+    QVector<int> m_levelStart;   // first bucket of each level
+};
+
+#endif
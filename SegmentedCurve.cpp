@@ -0,0 +1,111 @@
+#include "SegmentedCurve.h"
+#include <cmath>
+
+namespace {
+
+struct Evaluator {
+    const CompiledExpression *expression;
+    ExpressionBindings bindings;
+    double yMin;
+    double yMax;
+
+    double operator()(double x)
+    {
+        bindings.values[0] = x;
+        return expression->evaluate(bindings);
+    }
+
+    bool drawable(double y) const { return std::isfinite(y) && y >= yMin && y <= yMax; }
+
+    // Bisect [inside, outside] down to the edge of the drawable region, returns
+    // the last drawable point. Values leaving the y range end on the boundary.
+    QPointF edge(double inside, double outside)
+    {
+        for (int i = 0; i < SegmentedCurve::EdgeIterations; i++) {
+            const double mid = 0.5 * (inside + outside);
+            if (drawable((*this)(mid)))
+                inside = mid;
+            else
+                outside = mid;
+        }
+
+        const double y = (*this)(inside);
+        const double beyond = (*this)(outside);
+        if (std::isfinite(beyond))
+            return QPointF(inside, beyond > yMax ? yMax : (beyond < yMin ? yMin : y));
+        return QPointF(inside, y);
+    }
+};
+
+bool drawable(double y, double yMin, double yMax)
+{
+    return std::isfinite(y) && y >= yMin && y <= yMax;
+}
+
+} // namespace
+
+void SegmentedCurve::clear()
+{
+    m_points.clear();
+    m_starts.clear();
+    m_open = false;
+}
+
+void SegmentedCurve::append(double x, double y)
+{
+    if (!m_open) {
+        m_starts.append(int(m_points.size()));
+        m_open = true;
+    }
+    m_points.append(QPointF(x, y));
+}
+
+void SegmentedCurve::breakSegment()
+{
+    m_open = false;
+}
+
+void SegmentedCurve::build(const double *xs, const double *ys, int count, double yMin, double yMax,
+                           const CompiledExpression *expression, const ExpressionBindings &bindings)
+{
+    clear();
+    m_points.reserve(count);
+
+    const bool exact = expression && expression->isValid();
+    Evaluator f{ expression, bindings, yMin, yMax };
+
+    for (int j = 0; j < count; j++) {
+        const bool here = drawable(ys[j], yMin, yMax);
+        const bool previous = j > 0 && drawable(ys[j - 1], yMin, yMax);
+
+        if (here && !previous && j > 0 && exact) {
+            // Entering the drawable region, start exactly at its edge
+            const QPointF start = f.edge(xs[j], xs[j - 1]);
+            append(start.x(), start.y());
+        } else if (here && previous && exact && (ys[j - 1] < 0.0) != (ys[j] < 0.0)) {
+            // A sign change whose midpoint is invalid or larger than both ends is a pole
+            const double mid = 0.5 * (xs[j - 1] + xs[j]);
+            const double ym = f(mid);
+            if (!f.drawable(ym)) {
+                const QPointF end = f.edge(xs[j - 1], mid);
+                append(end.x(), end.y());
+                breakSegment();
+                const QPointF start = f.edge(xs[j], mid);
+                append(start.x(), start.y());
+            } else if (std::fabs(ym) > std::fmax(std::fabs(ys[j - 1]), std::fabs(ys[j]))) {
+                breakSegment();
+            }
+        }
+
+        if (here) {
+            append(xs[j], ys[j]);
+        } else if (previous) {
+            // Leaving the drawable region, end exactly at its edge
+            if (exact) {
+                const QPointF end = f.edge(xs[j - 1], xs[j]);
+                append(end.x(), end.y());
+            }
+            breakSegment();
+        }
+    }
+}
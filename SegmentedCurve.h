@@ -0,0 +1,45 @@
+// SegmentedCurve.h
+#ifndef SEGMENTEDCURVE_H
+#define SEGMENTEDCURVE_H
+
+#include <QPointF>
+#include <QVector>
+#include "ExpressionEngine.h"
+
+// Drawable points of one curve split into continuous segments. The points of
+// all segments share one buffer and starts marks where each segment begins,
+// so a renderer walks the whole curve in a single pass and lifts the pen at
+// the breaks instead of drawing lines across poles and domain gaps.
+class SegmentedCurve
+{
+public:
+    // Bisection steps when locating a segment edge, ~1e-12 of the sample spacing
+    static constexpr int EdgeIterations = 40;
+
+    // Build from samples ys at xs, keeping finite values within yMin..yMax.
+    // With an expression (slot 0 is x, bindings holds the other slots) each
+    // edge is located by bisection and poles between two drawable samples are
+    // detected; without one the segments end at the last drawable sample.
+    void build(const double *xs, const double *ys, int count, double yMin, double yMax,
+               const CompiledExpression *expression = nullptr,
+               const ExpressionBindings &bindings = ExpressionBindings());
+    void clear();
+
+    bool isEmpty() const { return m_points.isEmpty(); }
+    int segmentCount() const { return int(m_starts.size()); }
+    int segmentBegin(int segment) const { return m_starts[segment]; }
+    int segmentEnd(int segment) const {
+        return segment + 1 < m_starts.size() ? m_starts[segment + 1] : int(m_points.size());
+    }
+    const QVector<QPointF> &points() const { return m_points; }
+
+private:
+    void append(double x, double y);
+    void breakSegment();
+
+    QVector<QPointF> m_points;
+    QVector<int> m_starts;
+    bool m_open = false;
+};
+
+#endif
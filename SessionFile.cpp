@@ -0,0 +1,307 @@
+#include "SessionFile.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QSysInfo>
+#include <QtConcurrent>
+
+namespace {
+
+constexpr quint32 Magic = 0x45515353;   // "EQSS"
+constexpr quint16 Version = 1;
+constexpr qint64 HeaderSize = 32;
+
+// Where one sample channel lives in the file, count is 0 for an empty channel
+struct Block {
+    quint64 offset = 0;
+    quint64 bytes = 0;
+    qint32 count = 0;
+    qint32 precision = 0;
+};
+
+QDataStream &operator<<(QDataStream &out, const Block &block)
+{
+    return out << block.offset << block.bytes << block.count << block.precision;
+}
+
+QDataStream &operator>>(QDataStream &in, Block &block)
+{
+    return in >> block.offset >> block.bytes >> block.count >> block.precision;
+}
+
+qint64 alignUp(qint64 offset)
+{
+    return (offset + SessionFile::BlockAlignment - 1) / SessionFile::BlockAlignment * SessionFile::BlockAlignment;
+}
+
+bool validPrecision(qint32 precision)
+{
+    return precision == qint32(SamplePrecision::Double) || precision == qint32(SamplePrecision::Float);
+}
+
+qsizetype sampleSize(qint32 precision)
+{
+    return precision == qint32(SamplePrecision::Float) ? qsizetype(sizeof(float)) : qsizetype(sizeof(double));
+}
+
+// Copy one channel out of the file contents, false when the block doesn't fit
+bool readChannel(const char *data, qint64 size, const Block &block, bool compressed, SampleChannel &channel)
+{
+    if (block.count == 0) {
+        channel.clear();
+        return true;
+    }
+    if (block.count < 0 || !validPrecision(block.precision) || block.offset > quint64(size) ||
+        block.bytes > quint64(size) - block.offset)
+        return false;
+
+    const qsizetype expected = qsizetype(block.count) * sampleSize(block.precision);
+    const SamplePrecision precision = static_cast<SamplePrecision>(block.precision);
+    if (!compressed) {
+        if (qsizetype(block.bytes) != expected)
+            return false;
+        channel.assign(data + block.offset, block.count, precision);
+        return true;
+    }
+
+    const QByteArray inflated = qUncompress(reinterpret_cast<const uchar *>(data + block.offset), qsizetype(block.bytes));
+    if (inflated.size() != expected)
+        return false;
+    channel.assign(inflated.constData(), block.count, precision);
+    return true;
+}
+
+} // namespace
+
+bool SessionFile::save(const QString &fileName, const SessionSettings &settings, const EquationModel &plots,
+                       Samples samples, QString *error)
+{
+    // Channels to write, compressed up front so every offset is known before writing
+    struct Channel {
+        const SampleChannel *source;
+        QByteArray compressed;
+        Block block;
+    };
+    QVector<Channel> channels;
+    QVector<int> firstChannel(plots.size(), -1);
+    if (samples != Samples::None) {
+        for (int i = 0; i < plots.size(); i++) {
+            const SampleCache &cache = plots[i].samples;
+            if (cache.isEmpty())
+                continue;
+            firstChannel[i] = int(channels.size());
+            channels.append({ &cache.y, QByteArray(), Block() });
+            channels.append({ &cache.dy, QByteArray(), Block() });
+        }
+    }
+    const bool compress = samples == Samples::Compressed;
+    if (compress) {
+        QtConcurrent::blockingMap(channels, [](Channel &channel) {
+            if (!channel.source->isEmpty())
+                channel.compressed = qCompress(static_cast<const uchar *>(channel.source->rawData()),
+                                               channel.source->rawBytes());
+        });
+    }
+
+    qint64 offset = HeaderSize;
+    for (Channel &channel : channels) {
+        if (channel.source->isEmpty())
+            continue;
+        offset = alignUp(offset);
+        channel.block.offset = quint64(offset);
+        channel.block.bytes = quint64(compress ? channel.compressed.size() : channel.source->rawBytes());
+        channel.block.count = channel.source->count();
+        channel.block.precision = qint32(channel.source->precision());
+        offset += qint64(channel.block.bytes);
+    }
+
+    QByteArray metadata;
+    {
+        QDataStream out(&metadata, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << settings.title << settings.background << settings.text
+            << settings.xMin << settings.xMax << settings.yMin << settings.yMax
+            << qint32(settings.points) << settings.autoPoints << settings.oversampling
+            << qint32(settings.precision) << settings.time << settings.parameters;
+
+        out << qint32(plots.size());
+        for (int i = 0; i < plots.size(); i++) {
+            const EquationPlot &plot = plots[i];
+            out << plot.name << plot.equation << plot.color << plot.visible << plot.lineWidth
+                << qint32(plot.type) << plot.showDerivative << plot.showSecondDerivative << plot.initialValues;
+
+            // The key the samples were cached under, checked again when the plot is drawn
+            const bool hasSamples = firstChannel[i] >= 0;
+            out << hasSamples;
+            if (hasSamples) {
+                const SampleCache &cache = plot.samples;
+                out << cache.equation << cache.parameters << qint32(cache.mathMode) << cache.xMin << cache.step
+                    << channels[firstChannel[i]].block << channels[firstChannel[i] + 1].block;
+            }
+        }
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    {
+        QDataStream out(&file);
+        out << Magic << Version << quint8(QSysInfo::ByteOrder) << quint8(compress ? 1 : 0)
+            << quint64(offset) << quint64(metadata.size());
+    }
+    file.write(QByteArray(HeaderSize - file.pos(), '\0'));
+
+    for (const Channel &channel : channels) {
+        if (channel.source->isEmpty())
+            continue;
+        file.write(QByteArray(qint64(channel.block.offset) - file.pos(), '\0'));
+        if (compress)
+            file.write(channel.compressed);
+        else
+            file.write(static_cast<const char *>(channel.source->rawData()), channel.source->rawBytes());
+    }
+    file.write(metadata);
+
+    if (!file.commit()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SessionFile::load(const QString &fileName, SessionSettings &settings, QList<EquationPlot> &plots,
+                       QString *error)
+{
+    plots.clear();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    // Map the whole file so sample blocks are copied straight out of the page cache
+    const qint64 size = file.size();
+    QByteArray contents;
+    const char *data = nullptr;
+    if (size >= HeaderSize) {
+        if (uchar *mapped = file.map(0, size)) {
+            data = reinterpret_cast<const char *>(mapped);
+        } else {
+            contents = file.readAll();
+            data = contents.constData();
+        }
+    }
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint8 byteOrder = 0;
+    quint8 compressed = 0;
+    quint64 metadataOffset = 0;
+    quint64 metadataSize = 0;
+    if (data) {
+        QDataStream in(QByteArray::fromRawData(data, HeaderSize));
+        in >> magic >> version >> byteOrder >> compressed >> metadataOffset >> metadataSize;
+    }
+    if (magic != Magic) {
+        if (error)
+            *error = "Not a session file.";
+        return false;
+    }
+    if (version > Version) {
+        if (error)
+            *error = "The session was saved by a newer version.";
+        return false;
+    }
+    if (metadataOffset > quint64(size) || metadataSize > quint64(size) - metadataOffset) {
+        if (error)
+            *error = "The session file is truncated.";
+        return false;
+    }
+
+    struct Pending {
+        EquationPlot *plot;
+        Block y;
+        Block dy;
+    };
+    QVector<Pending> pending;
+    QVector<int> sampledRows;
+    QList<Block> blocks;
+
+    QDataStream in(QByteArray::fromRawData(data + metadataOffset, qsizetype(metadataSize)));
+    in.setVersion(QDataStream::Qt_6_0);
+    qint32 points = 0;
+    qint32 precision = 0;
+    in >> settings.title >> settings.background >> settings.text
+       >> settings.xMin >> settings.xMax >> settings.yMin >> settings.yMax
+       >> points >> settings.autoPoints >> settings.oversampling >> precision >> settings.time >> settings.parameters;
+    settings.points = points;
+    settings.precision = static_cast<SamplePrecision>(precision);
+    if (!validPrecision(precision))
+        in.setStatus(QDataStream::ReadCorruptData);
+
+    qint32 count = 0;
+    in >> count;
+    QSet<QString> names;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        EquationPlot plot;
+        qint32 type = 0;
+        bool hasSamples = false;
+        in >> plot.name >> plot.equation >> plot.color >> plot.visible >> plot.lineWidth
+           >> type >> plot.showDerivative >> plot.showSecondDerivative >> plot.initialValues >> hasSamples;
+        plot.type = static_cast<PlotType>(type);
+        if (type < 0 || type > qint32(PlotType::Complex) || names.contains(plot.name))
+            in.setStatus(QDataStream::ReadCorruptData);
+        names.insert(plot.name);
+
+        if (hasSamples) {
+            qint32 mathMode = 0;
+            Block y;
+            Block dy;
+            in >> plot.samples.equation >> plot.samples.parameters >> mathMode >> plot.samples.xMin
+               >> plot.samples.step >> y >> dy;
+            plot.samples.mathMode = static_cast<MathMode>(mathMode);
+            if (mathMode < 0 || mathMode > qint32(MathMode::Fast) || !validPrecision(y.precision) ||
+                !validPrecision(dy.precision))
+                in.setStatus(QDataStream::ReadCorruptData);
+            sampledRows.append(int(plots.size()));
+            blocks << y << dy;
+        }
+        plots.append(plot);
+    }
+    if (in.status() != QDataStream::Ok) {
+        plots.clear();
+        if (error)
+            *error = "The session file is corrupt.";
+        return false;
+    }
+
+    // Samples are only usable in the byte order they were written in
+    if (byteOrder != quint8(QSysInfo::ByteOrder)) {
+        for (int row : sampledRows)
+            plots[row].samples.clear();
+        sampledRows.clear();
+    }
+    for (int k = 0; k < sampledRows.size(); k++)
+        pending.append({ &plots[sampledRows[k]], blocks[2 * k], blocks[2 * k + 1] });
+
+    // Copy the channels and rebuild the pyramids in parallel, a block that
+    // doesn't check out only costs that plot its cache
+    QtConcurrent::blockingMap(pending, [&](Pending &entry) {
+        SampleCache &cache = entry.plot->samples;
+        const bool valid = readChannel(data, size, entry.y, compressed, cache.y) &&
+                           readChannel(data, size, entry.dy, compressed, cache.dy) &&
+                           (cache.dy.isEmpty() || cache.dy.count() == cache.y.count());
+        if (valid)
+            cache.pyramid.build(cache.y);
+        else
+            cache.clear();
+    });
+    return true;
+}
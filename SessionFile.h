@@ -0,0 +1,58 @@
+// SessionFile.h
+#ifndef SESSIONFILE_H
+#define SESSIONFILE_H
+
+#include <QColor>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "EquationModel.h"
+#include "SampleCache.h"
+
+// Everything about a session that isn't stored per equation
+struct SessionSettings {
+    QString title;
+    QColor background;
+    QColor text;
+    double xMin = -10.0;
+    double xMax = 10.0;
+    double yMin = -10.0;
+    double yMax = 10.0;
+    int points = 1000;
+    bool autoPoints = false;
+    double oversampling = 2.0;
+    SamplePrecision precision = SamplePrecision::Double;
+    double time = 0.0;
+    QVector<QPair<QString, double>> parameters;
+};
+
+// Binary session files. The equation list, styles and settings are a small
+// QDataStream record at the end of the file; cached samples, when included,
+// are written before it as raw channels in their stored precision, each
+// aligned to BlockAlignment bytes. Loading maps the file and copies every
+// channel into the sample pool with one memcpy, or inflates it when it was
+// saved compressed, so a reopened session draws from its caches without
+// evaluating anything. Samples from a machine of the other byte order are
+// skipped and simply sampled again.
+class SessionFile
+{
+public:
+    enum class Samples {
+        None,        // equations and settings only
+        Raw,         // channels as they are in memory, mapped back on load
+        Compressed   // zlib compressed channels, smaller but inflated on load
+    };
+
+    static constexpr int BlockAlignment = 64;
+
+    static bool save(const QString &fileName, const SessionSettings &settings, const EquationModel &plots,
+                     Samples samples, QString *error = nullptr);
+
+    // Plots come back uncompiled and without series, with their cached samples
+    // and pyramids restored when the file has them
+    static bool load(const QString &fileName, SessionSettings &settings, QList<EquationPlot> &plots,
+                     QString *error = nullptr);
+};
+
+#endif
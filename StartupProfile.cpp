@@ -0,0 +1,38 @@
+#include "StartupProfile.h"
+#include <QDebug>
+
+bool StartupProfile::s_enabled = false;
+QElapsedTimer StartupProfile::s_clock;
+qint64 StartupProfile::s_last = 0;
+QList<QPair<const char *, qint64>> StartupProfile::s_phases;
+
+void StartupProfile::start()
+{
+    s_enabled = true;
+    s_clock.start();
+    s_last = 0;
+}
+
+void StartupProfile::mark(const char *phase)
+{
+    if (!s_enabled)
+        return;
+
+    const qint64 now = s_clock.nsecsElapsed();
+    s_phases.append({ phase, now - s_last });
+    s_last = now;
+}
+
+void StartupProfile::finish()
+{
+    if (!s_enabled)
+        return;
+
+    mark("first frame");
+    s_enabled = false;
+
+    qInfo().noquote() << "Startup profile:";
+    for (const auto &phase : s_phases)
+        qInfo().noquote() << QString("  %1 %2 ms").arg(QString(phase.first), -24).arg(phase.second / 1e6, 0, 'f', 2);
+    qInfo().noquote() << QString("  %1 %2 ms").arg(QString("time to first frame"), -24).arg(s_last / 1e6, 0, 'f', 2);
+}
@@ -0,0 +1,31 @@
+// StartupProfile.h
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+
+// Wall-clock breakdown of startup, enabled by --startup-profile. Phases are
+// marked as they finish, each is timed from the previous mark, and the report
+// is printed once the first frame of the main window has been painted.
+class StartupProfile
+{
+public:
+    // Start the clock, called first thing in main()
+    static void start();
+    static bool isEnabled() { return s_enabled; }
+
+    static void mark(const char *phase);
+
+    // Mark the first frame and print the report, only the first call counts
+    static void finish();
+
+private:
+    static bool s_enabled;
+    static QElapsedTimer s_clock;
+    static qint64 s_last;
+    static QList<QPair<const char *, qint64>> s_phases;
+};
+
+#endif
@@ -0,0 +1,182 @@
+// TileCache.h
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+// Tile at grid position (ix, iy) for the pixel size (dx, dy)
+struct TileKey {
+    qint64 ix;
+    qint64 iy;
+    double dx;
+    double dy;
+
+    bool operator==(const TileKey &other) const {
+        return ix == other.ix && iy == other.iy && dx == other.dx && dy == other.dy;
+    }
+};
+
+inline size_t qHash(const TileKey &key, size_t seed)
+{
+    return qHashMulti(seed, key.ix, key.iy, key.dx, key.dy);
+}
+
+// Tiles of the plane for HeatmapRenderer and DomainColoring. The plane is
+// split into fixed-size pixel tiles aligned to a global grid, so panning at
+// the same scale reuses every tile that is still visible and only computes
+// the new ones. Tiles of previous scales stay cached, zooming back is free as
+// well. Tile holds the data of one tile with rows from the smallest y up, the
+// renderer supplies the function that fills it and copies it into the image.
+template <typename Tile>
+class TileCache
+{
+public:
+    // 64x64 samples = 16 KB of floats or colours per tile, inside L1/L2 while evaluating
+    static constexpr int TileSize = 64;
+    static constexpr int MaxTiles = 4096;
+
+    // World coordinates of the centre of pixel u or v of a tile
+    static double x(const TileKey &key, int u) { return (key.ix * TileSize + u + 0.5) * key.dx; }
+    static double y(const TileKey &key, int v) { return (key.iy * TileSize + v + 0.5) * key.dy; }
+
+    // Find the tiles covering the world rectangle (y = top..bottom with top <
+    // bottom) at the given pixel size and fill the missing ones with
+    // fill(const TileKey &, Tile &) in parallel on the global thread pool.
+    // The returned tiles stay valid until the next update() or clear().
+    template <typename Fill>
+    const QVector<const Tile *> &update(const QRectF &world, const QSize &pixels, Fill fill)
+    {
+        evictUnused();
+        m_frame++;
+        m_width = pixels.width();
+        m_height = pixels.height();
+        const double dx = world.width() / m_width;
+        const double dy = world.height() / m_height;
+
+        // Global pixel indices of the leftmost column and the bottom row
+        m_gx0 = qint64(std::floor(world.left() / dx));
+        m_gy0 = qint64(std::floor(world.top() / dy));
+        m_tx0 = floorDiv(m_gx0, TileSize);
+        m_ty0 = floorDiv(m_gy0, TileSize);
+        m_tilesX = int(floorDiv(m_gx0 + m_width - 1, TileSize) - m_tx0) + 1;
+        const int tilesY = int(floorDiv(m_gy0 + m_height - 1, TileSize) - m_ty0) + 1;
+
+        // Insert placeholders for missing tiles first, so the pointers taken below stay valid
+        QVector<TileKey> keys;
+        keys.reserve(m_tilesX * tilesY);
+        for (int j = 0; j < tilesY; j++) {
+            for (int i = 0; i < m_tilesX; i++) {
+                const TileKey key{ m_tx0 + i, m_ty0 + j, dx, dy };
+                keys.append(key);
+                if (!m_tiles.contains(key))
+                    m_tiles.insert(key, Entry());
+            }
+        }
+
+        struct Job {
+            TileKey key;
+            Entry *entry;
+        };
+        QVector<Job> jobs;
+        m_visible.clear();
+        m_visible.reserve(keys.size());
+        for (const TileKey &key : keys) {
+            Entry *entry = &m_tiles[key];
+            entry->lastUsed = m_frame;
+            m_visible.append(&entry->tile);
+            if (!entry->ready)
+                jobs.append({ key, entry });
+        }
+
+        QtConcurrent::blockingMap(jobs, [&fill](Job &job) {
+            fill(job.key, job.entry->tile);
+            job.entry->ready = true;
+        });
+
+        m_lastComputed = int(jobs.size());
+        m_lastVisible = int(m_visible.size());
+        return m_visible;
+    }
+
+    // Walk the image of the last update() from the top row, the largest y,
+    // calling span(QRgb *pixels, const Tile &tile, int offset, int count) for
+    // each run of pixels within one tile. offset is v * TileSize + u.
+    template <typename Span>
+    void forEachSpan(QImage &image, Span span) const
+    {
+        for (int r = 0; r < m_height; r++) {
+            const qint64 gy = m_gy0 + (m_height - 1 - r);
+            const int j = int(floorDiv(gy, TileSize) - m_ty0);
+            const int v = int(gy - floorDiv(gy, TileSize) * TileSize);
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(r));
+
+            int c = 0;
+            while (c < m_width) {
+                const qint64 gx = m_gx0 + c;
+                const int i = int(floorDiv(gx, TileSize) - m_tx0);
+                const int u0 = int(gx - floorDiv(gx, TileSize) * TileSize);
+                const int count = std::min(TileSize - u0, m_width - c);
+                span(line + c, *m_visible[j * m_tilesX + i], v * TileSize + u0, count);
+                c += count;
+            }
+        }
+    }
+
+    void clear()
+    {
+        m_tiles.clear();
+        m_visible.clear();
+    }
+    int lastComputed() const { return m_lastComputed; }
+    int lastVisible() const { return m_lastVisible; }
+
+private:
+    struct Entry {
+        Tile tile;
+        bool ready = false;
+        quint64 lastUsed = 0;
+    };
+
+    static qint64 floorDiv(qint64 a, qint64 b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    // Drop the tiles the last frame didn't use once the cache is full. Runs
+    // before the next frame, erasing moves the entries the visible list points to.
+    void evictUnused()
+    {
+        if (m_tiles.size() <= MaxTiles)
+            return;
+
+        m_visible.clear();
+        for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+            if (it->lastUsed != m_frame)
+                it = m_tiles.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    QHash<TileKey, Entry> m_tiles;
+    QVector<const Tile *> m_visible;
+    quint64 m_frame = 0;
+    qint64 m_gx0 = 0;
+    qint64 m_gy0 = 0;
+    qint64 m_tx0 = 0;
+    qint64 m_ty0 = 0;
+    int m_tilesX = 0;
+    int m_width = 0;
+    int m_height = 0;
+    int m_lastComputed = 0;
+    int m_lastVisible = 0;
+};
+
+#endif